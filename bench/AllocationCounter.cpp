@@ -0,0 +1,28 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+namespace {
+    std::atomic<size_t> allocations {0};
+}
+
+void *operator new(const size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = std::malloc(size > 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+size_t allocation_count() noexcept {
+    return allocations.load(std::memory_order_relaxed);
+}
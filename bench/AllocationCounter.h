@@ -0,0 +1,16 @@
+#ifndef LABEL_PRINTER_DRIVER_ALLOCATIONCOUNTER_H
+#define LABEL_PRINTER_DRIVER_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+/**
+ * Number of allocations made with operator new in the whole program so far (memory which cairo
+ * allocates with malloc isn't counted).
+ *
+ * Allocations are counted by replacement of the global operator new in `AllocationCounter.cpp`,
+ * which is linked only into the benchmarks.
+ */
+[[nodiscard]] size_t allocation_count() noexcept;
+
+
+#endif //LABEL_PRINTER_DRIVER_ALLOCATIONCOUNTER_H
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+#include "AllocationCounter.h"
+#include "../label/Label.h"
+#include "../label/ProductLabel.h"
+#include "../label/ProductLabelCreator.h"
+#include "../label/RasterConverter.h"
+#include "../printer/PrinterJobData.h"
+#include "../printer/PrinterStatus.h"
+
+using std::cout, std::endl;
+
+/**
+ * Access of the benchmarks to steps of `ProductLabel` which aren't public.
+ */
+class ProductLabelBenchmark {
+public:
+    [[nodiscard]] static std::vector<uint8_t> prepare_for_printing(const ProductLabel& label,
+            cairo_surface_t *surface) {
+        return label.prepare_for_printing(surface);
+    }
+};
+
+namespace {
+    constexpr uint8_t CONTINUOUS_LENGTH_WIDTH_MM = 100;
+    constexpr std::time_t START_DATE = 1700000000;  /**< Fixed, so that all of the runs render the same dates */
+    constexpr size_t MIN_ITERATIONS = 5;
+    constexpr const char *RENDER_CACHED = "render_rasterize_cached";
+    constexpr const char *RENDER_UNCACHED = "render_rasterize_uncached";
+
+    const std::array<std::pair<const char*, TextEngine>, 2> TEXT_ENGINES {{
+            {"render_uncached_cairo", TextEngine::CAIRO},
+            {"render_uncached_glyph_atlas", TextEngine::GLYPH_ATLAS}
+    }};
+
+    struct Result {
+        std::string benchmark;
+        std::string subtype;
+        size_t iterations;
+        double ns_per_label;
+        double bytes_per_second;  /**< Bytes produced (or decoded) per second */
+        double allocations_per_label;
+        long peak_rss_kb;  /**< Peak resident set size of the process so far */
+    };
+
+    long peak_rss_kb() {
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    /**
+     * Calls `f` once to warm up and then in batches of doubling size until it has run for at least
+     * `min_time` and `MIN_ITERATIONS` times, so that cheap functions aren't dominated by reading the clock.
+     *
+     * @param f Benchmarked function, which returns number of bytes it produced
+     */
+    template<typename F>
+    Result measure(const std::string& benchmark, const std::string& subtype, const std::chrono::milliseconds min_time,
+            F&& f) {
+        f();
+
+        size_t iterations = 0;
+        size_t bytes = 0;
+        std::chrono::duration<double, std::nano> elapsed {};
+        const size_t allocations_before = allocation_count();
+
+        for(size_t batch = 1; iterations < MIN_ITERATIONS || elapsed < min_time; batch *= 2) {
+            const auto start = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < batch; ++i)
+                bytes += f();
+            elapsed += std::chrono::steady_clock::now() - start;
+            iterations += batch;
+        }
+
+        const size_t allocated = allocation_count() - allocations_before;
+        return {benchmark, subtype, iterations, elapsed.count() / iterations, bytes / (elapsed.count() * 1e-9),
+                static_cast<double>(allocated) / iterations, peak_rss_kb()};
+    }
+
+    /**
+     * @return Status messages which the printer sends while printing on media with given format
+     */
+    std::vector<std::array<uint8_t, 32>> status_packets(const LabelFormat& format) {
+        const std::array<std::array<uint8_t, 3>, 5> statuses {{
+                {static_cast<uint8_t>(StatusType::REPLY_TO_STATUS_REQUEST), 0x00, 0x00},
+                {static_cast<uint8_t>(StatusType::PHASE_CHANGE), static_cast<uint8_t>(PhaseType::PRINTING_STATE), 0x00},
+                {static_cast<uint8_t>(StatusType::PRINTING_COMPLETED), 0x00, 0x00},
+                {static_cast<uint8_t>(StatusType::NOTIFICATION), 0x00, static_cast<uint8_t>(NotificationType::COOLING_START)},
+                {static_cast<uint8_t>(StatusType::ERROR_OCCURRED), 0x00, 0x00}
+        }};
+
+        std::vector<std::array<uint8_t, 32>> packets {};
+        for(const auto& [status, phase, notification]: statuses) {
+            std::array<uint8_t, 32> packet {0x80, 0x20, 0x42, 0x34, 0x35, 0x30};
+            packet[PrinterStatus::MEDIA_WIDTH_OFFSET] = format.dimensions.height_mm;
+            packet[PrinterStatus::MEDIA_LENGTH_OFFSET] = format.type == LabelType::DIE_CUT ? format.dimensions.width_mm : 0;
+            packet[PrinterStatus::MEDIA_TYPE_OFFSET] = static_cast<uint8_t>(format.type == LabelType::DIE_CUT
+                    ? MediaType::DIE_CUT_LABELS : MediaType::CONTINUOUS_LENGTH_TAPE);
+            packet[PrinterStatus::STATUS_TYPE_OFFSET] = status;
+            packet[PrinterStatus::PHASE_TYPE_OFFSET] = phase;
+            packet[PrinterStatus::NOTIFICATION_TYPE_OFFSET] = notification;
+            if(status == static_cast<uint8_t>(StatusType::ERROR_OCCURRED))
+                packet[PrinterStatus::ERROR_TYPE_OFFSET] = 0x02;  // End of media
+            packets.push_back(packet);
+        }
+        return packets;
+    }
+
+    /**
+     * Runs all of the benchmarks with one media format.
+     */
+    void run(const std::string& subtype, const LabelFormat& format, const std::chrono::milliseconds min_time,
+            std::vector<Result>& results) {
+        const ProductLabel label("Chicken breast", ProductUsage::PREP, START_DATE, "2h", "3d", format);
+
+        results.push_back(measure("create_label_surface", subtype, min_time, [&] {
+            cairo_surface_t *surface = ProductLabelCreator::create_label_surface(label);
+            const size_t bytes = static_cast<size_t>(cairo_image_surface_get_stride(surface))
+                    * cairo_image_surface_get_height(surface);
+            cairo_surface_destroy(surface);
+            return bytes;
+        }));
+
+        cairo_surface_t *surface = ProductLabelCreator::create_label_surface(label);
+        results.push_back(measure("prepare_for_printing", subtype, min_time, [&] {
+            return ProductLabelBenchmark::prepare_for_printing(label, surface).size();
+        }));
+        cairo_surface_destroy(surface);
+
+        // Same label again is found in the raster cache - the steady state of the print loop, which doesn't allocate
+        std::vector<uint8_t> printing_data {};
+        results.push_back(measure(RENDER_CACHED, subtype, min_time, [&] {
+            const std::unique_ptr<RenderedLabel> rendered = label.render();
+            label.rasterize(rendered.get(), printing_data);
+            return printing_data.size();
+        }));
+
+        // With the cache disabled the label is drawn every time. Surfaces with their memory, cache keys and
+        // rendered labels come from pools, so this doesn't allocate either (with the default text engine)
+        RasterCache& cache = ProductLabelCreator::get_raster_cache();
+        const size_t memory_budget = cache.get_memory_budget();
+        cache.set_memory_budget(0);
+        results.push_back(measure(RENDER_UNCACHED, subtype, min_time, [&] {
+            const std::unique_ptr<RenderedLabel> rendered = label.render();
+            label.rasterize(rendered.get(), printing_data);
+            return printing_data.size();
+        }));
+        cache.set_memory_budget(memory_budget);
+
+        // Cache is cleared before every label, so that the whole label is drawn by each text engine
+        for(const auto& [benchmark, engine]: TEXT_ENGINES) {
+            ProductLabelCreator::set_text_engine(engine);
+            results.push_back(measure(benchmark, subtype, min_time, [&] {
+                cache.clear();
+                const std::unique_ptr<RenderedLabel> rendered = label.render();
+                label.rasterize(rendered.get(), printing_data);
+                return printing_data.size();
+            }));
+        }
+        ProductLabelCreator::set_text_engine(TextEngine::CAIRO);
+
+        const PrinterJobData job_data(format);
+        std::vector<uint8_t> message {};
+        results.push_back(measure("construct_job_data_message", subtype, min_time, [&] {
+            job_data.construct_job_data_message(message);
+            return message.size();
+        }));
+
+        JobHeader header = job_data.construct_job_header();
+        size_t page = 0;
+        results.push_back(measure("patch_job_header", subtype, min_time, [&] {
+            header.set_starting_page(page++ == 0);
+            return header.size();
+        }));
+
+        const std::vector<std::array<uint8_t, 32>> packets = status_packets(format);
+        size_t next_packet = 0;
+        volatile size_t known_statuses = 0;
+        results.push_back(measure("PrinterStatus", subtype, min_time, [&] {
+            const std::array<uint8_t, 32>& packet = packets[next_packet++ % packets.size()];
+            const PrinterStatus status(packet);
+            known_statuses += PrinterStatus::status_type_codes.count(static_cast<StatusType>(status.status_code))
+                    + PrinterStatus::error_type_codes.count(static_cast<ErrorType>(status.error_code));
+            return packet.size();
+        }));
+
+        const std::string png_file = (std::filesystem::temp_directory_path() / ("microbench_" + subtype + ".png")).string();
+        results.push_back(measure("export_to_png", subtype, min_time, [&] {
+            ProductLabelCreator::export_to_png(label, png_file);
+            return static_cast<size_t>(std::filesystem::file_size(png_file));
+        }));
+        std::filesystem::remove(png_file);
+    }
+
+    bool is_black(const std::vector<uint8_t>& printing_data, const LabelDimensions& dim, const long column,
+            const long row) {
+        if(column < 0 || row < 0 || column >= dim.width_pt || row >= dim.height_pt)
+            return false;
+        const size_t byte = column * RasterConverter::PACKET_SIZE + RasterConverter::COMMAND_SIZE + row / 8;
+        return printing_data[byte] & (0x80u >> (row % 8));
+    }
+
+    /**
+     * @return Number of black pixels of `a` which don't have any black pixel of `b` at most one pixel away
+     */
+    size_t unmatched_pixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, const LabelDimensions& dim) {
+        size_t unmatched = 0;
+        for(long column = 0; column < dim.width_pt; ++column) {
+            for(long row = 0; row < dim.height_pt; ++row) {
+                if(!is_black(a, dim, column, row))
+                    continue;
+
+                bool matched = false;
+                for(long dx = -1; dx <= 1 && !matched; ++dx) {
+                    for(long dy = -1; dy <= 1 && !matched; ++dy)
+                        matched = is_black(b, dim, column + dx, row + dy);
+                }
+                unmatched += !matched;
+            }
+        }
+        return unmatched;
+    }
+
+    /**
+     * Checks that labels drawn with `TextEngine::GLYPH_ATLAS` differ from `TextEngine::CAIRO` only by
+     * placement of glyphs on whole pixels - every black pixel of one has a black pixel at most one pixel
+     * away in the other.
+     */
+    bool check_text_engines(const std::string& subtype, const LabelFormat& format) {
+        const std::array<ProductLabel, 2> labels {
+                ProductLabel("Chicken breast", ProductUsage::PREP, START_DATE, "2h", "3d", format),
+                ProductLabel("Smoked salmon with dill", ProductUsage::STORAGE, START_DATE, std::nullopt, "5d", format)
+        };
+
+        bool matches = true;
+        for(const ProductLabel& label: labels) {
+            std::array<std::vector<uint8_t>, TEXT_ENGINES.size()> printing_data {};
+            for(size_t i = 0; i < TEXT_ENGINES.size(); ++i) {
+                ProductLabelCreator::set_text_engine(TEXT_ENGINES[i].second);
+                printing_data[i] = label.get_printing_data();
+            }
+            ProductLabelCreator::set_text_engine(TextEngine::CAIRO);
+
+            const LabelDimensions& dim = format.dimensions;
+            if(printing_data[0].size() != printing_data[1].size()) {
+                std::cerr << "Text engines produce printing data of different size with " << subtype << endl;
+                matches = false;
+                continue;
+            }
+
+            const size_t unmatched = unmatched_pixels(printing_data[0], printing_data[1], dim)
+                    + unmatched_pixels(printing_data[1], printing_data[0], dim);
+            if(unmatched > 0) {
+                std::cerr << "Text engines differ by more than one pixel with " << subtype << " (" << unmatched
+                          << " pixels)" << endl;
+                matches = false;
+            }
+        }
+        return matches;
+    }
+
+    void print_table(const std::vector<Result>& results) {
+        cout << std::left << std::setw(28) << "Benchmark" << std::setw(12) << "Subtype"
+             << std::right << std::setw(12) << "Iterations" << std::setw(16) << "ns/label" << std::setw(14) << "MB/s"
+             << std::setw(14) << "Allocs/label" << std::setw(16) << "Peak RSS [kB]" << endl;
+
+        for(const Result& result: results) {
+            cout << std::left << std::setw(28) << result.benchmark << std::setw(12) << result.subtype
+                 << std::right << std::setw(12) << result.iterations << std::fixed << std::setprecision(1)
+                 << std::setw(16) << result.ns_per_label << std::setw(14) << result.bytes_per_second / 1e6
+                 << std::setprecision(2) << std::setw(14) << result.allocations_per_label
+                 << std::setw(16) << result.peak_rss_kb << endl;
+        }
+    }
+
+    void write_json(const std::vector<Result>& results, const std::string& filename) {
+        std::ofstream file(filename);
+        if(!file)
+            throw std::runtime_error("Can't open " + filename);
+
+        file << "{\"benchmarks\": [" << std::setprecision(10);
+        for(size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            file << (i > 0 ? "," : "") << "\n  {\"name\": \"" << result.benchmark << "\", \"subtype\": \"" << result.subtype
+                 << "\", \"iterations\": " << result.iterations << ", \"ns_per_label\": " << result.ns_per_label
+                 << ", \"bytes_per_second\": " << result.bytes_per_second
+                 << ", \"allocations_per_label\": " << result.allocations_per_label
+                 << ", \"peak_rss_kb\": " << result.peak_rss_kb << "}";
+        }
+        file << "\n]}\n";
+    }
+}
+
+/*
+Usage: label_printer_driver_microbench [label_conf.yml] [--json <file>] [--min-time-ms <ms>]
+
+Runs each benchmark with every continuous length (100mm long) and die-cut subtype and prints
+a table. With `--json` the results are also written to a file for comparison between releases.
+Exits with 1 if the cached or uncached render allocates or if labels drawn by the text engines differ by more
+than one pixel.
+*/
+int main(int argc, char *argv[]) {
+    std::string config_file = "../label/label_conf.yml";
+    std::string json_file {};
+    std::chrono::milliseconds min_time {200};
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if(arg == "--json" && i + 1 < argc)
+            json_file = argv[++i];
+        else if(arg == "--min-time-ms" && i + 1 < argc)
+            min_time = std::chrono::milliseconds(std::stoi(argv[++i]));
+        else if(arg.rfind("--", 0) == 0) {
+            std::cerr << "Usage: " << argv[0] << " [label_conf.yml] [--json <file>] [--min-time-ms <ms>]" << endl;
+            return 2;
+        }
+        else
+            config_file = arg;
+    }
+
+    ProductLabelCreator::load_config(config_file);
+
+    std::vector<std::pair<std::string, LabelFormat>> formats {};
+    for(const auto& [subtype, dim]: LabelSubtypes::__continuous_length_dimensions) {
+        formats.emplace_back("CL_" + std::to_string(dim.height_mm),
+                LabelFormat::continuous_length(subtype, CONTINUOUS_LENGTH_WIDTH_MM));
+    }
+    for(const auto& [subtype, dim]: LabelSubtypes::__die_cut_dimensions)
+        formats.emplace_back("DC_" + std::to_string(dim.height_mm) + "x" + std::to_string(dim.width_mm),
+                LabelFormat::die_cut(subtype));
+
+    std::vector<Result> results {};
+    for(const auto& [subtype, format]: formats)
+        run(subtype, format, min_time, results);
+
+    print_table(results);
+    if(!json_file.empty())
+        write_json(results, json_file);
+
+    bool ok = true;
+    for(const Result& result: results) {
+        if((result.benchmark == RENDER_CACHED || result.benchmark == RENDER_UNCACHED)
+                && result.allocations_per_label > 0) {
+            std::cerr << result.benchmark << " allocates with " << result.subtype << endl;
+            ok = false;
+        }
+    }
+    for(const auto& [subtype, format]: formats)
+        ok &= check_text_engines(subtype, format);
+    return ok ? 0 : 1;
+}
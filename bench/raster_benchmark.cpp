@@ -0,0 +1,881 @@
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "AllocationCounter.h"
+#include "../daemon/PrintDaemon.h"
+#include "../label/BatchRenderer.h"
+#include "../label/Label.h"
+#include "../label/RasterConverter.h"
+#include "../printer/PageBuilder.h"
+#include "../printer/Printer.h"
+#include "../printer/PrinterPool.h"
+#include "../printer/SimulatedPrinter.h"
+#include "../exceptions/PrinterError.h"
+#include "../utils/BoundedQueue.h"
+#include "../utils/BufferPool.h"
+#include "../utils/Logger.h"
+#include "../utils/Metrics.h"
+#include "../utils/Tracer.h"
+
+using std::cout, std::endl;
+
+namespace {
+    constexpr int ITERATIONS = 20;
+    constexpr uint8_t CONTINUOUS_LENGTH_WIDTH_MM = 100;
+    constexpr const char *CONFIG_FILE = "../label/label_conf.yml";  /**< Paths are relative to the build directory */
+    constexpr const char *DEFINITIONS_FILE = "../label/label_def_example.yml";
+
+    /**
+     * Column by column conversion which was used before `RasterConverter`. Serves both as a baseline
+     * and as a reference for the output.
+     *
+     * @param is_black Called with column and row of each pixel
+     */
+    template<typename IsBlack>
+    std::vector<uint8_t> naive_columns(const LabelDimensions& dim, IsBlack&& is_black) {
+        std::vector<uint8_t> printing_data {};
+        printing_data.reserve(dim.width_pt * 93);
+
+        const bool unaligned_pixels = dim.height_pt % 8 != 0;
+        const auto fill_amount = static_cast<size_t>(90 - std::ceil(dim.height_pt / 8.0));
+
+        uint8_t pixel_octet = 0;
+        uint8_t pixels_packed = 7;
+
+        for(unsigned i = 0; i < dim.width_pt; ++i) {
+            printing_data.insert(printing_data.end(), {0x67, 0x00, 0x5a});
+
+            for(unsigned k = 0; k < dim.height_pt; ++k) {
+                const bool pixel = is_black(i, k);
+                pixel_octet |= static_cast<uint8_t>(pixel << pixels_packed);
+
+                if(pixels_packed == 0) {
+                    printing_data.push_back(pixel_octet);
+                    pixel_octet = 0;
+                    pixels_packed = 7;
+                }
+                else
+                    --pixels_packed;
+            }
+
+            if(unaligned_pixels) {
+                printing_data.push_back(pixel_octet);
+                pixel_octet = 0;
+                pixels_packed = 7;
+            }
+
+            printing_data.insert(printing_data.end(), fill_amount, 0x00);
+        }
+
+        return printing_data;
+    }
+
+    /**
+     * Naive conversion of RGB24 image (with the same fixed point luma as `RasterConverter`).
+     */
+    std::vector<uint8_t> naive_columns(const unsigned char *label_data, const int stride, const LabelDimensions& dim) {
+        return naive_columns(dim, [&](const unsigned column, const unsigned row) {
+            const unsigned char *pix = label_data + (row * stride + column * 4);
+            return (pix[0] * 77u + pix[1] * 150u + pix[2] * 29u) < (Label::DEFAULT_THRESHOLD << 8u);
+        });
+    }
+
+    /**
+     * Fills RGB24 image with something that resembles a label: white background,
+     * black lines and antialiased (gray) pixels around them.
+     */
+    std::vector<unsigned char> make_image(const LabelDimensions& dim, const int stride) {
+        std::vector<unsigned char> image(static_cast<size_t>(stride) * dim.height_pt, 0xff);
+        uint32_t seed = 12345;
+
+        for(uint32_t y = 0; y < dim.height_pt; ++y) {
+            for(uint32_t x = 0; x < dim.width_pt; ++x) {
+                seed = seed * 1103515245u + 12345u;
+                unsigned char value = 0xff;
+                if(y % 97 < 3 || x % 131 < 3)
+                    value = 0x00;
+                else if((seed >> 16u) % 5 == 0)
+                    value = static_cast<unsigned char>(seed >> 8u);
+
+                unsigned char *pix = image.data() + static_cast<size_t>(y) * stride + x * 4;
+                pix[0] = pix[1] = pix[2] = value;
+            }
+        }
+
+        return image;
+    }
+
+    template<typename F>
+    double measure_ns(F&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < ITERATIONS; ++i)
+            f();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    }
+
+    /**
+     * Converts gray RGB24 image from `make_image()` into A8 image of ink coverage (`255 - gray`)
+     * with the row stride of cairo.
+     */
+    std::vector<unsigned char> to_a8(const std::vector<unsigned char>& image, const LabelDimensions& dim,
+            const int a8_stride) {
+        const size_t stride = dim.width_pt * 4;
+        std::vector<unsigned char> a8(static_cast<size_t>(a8_stride) * dim.height_pt, 0x00);
+        for(uint32_t y = 0; y < dim.height_pt; ++y) {
+            for(uint32_t x = 0; x < dim.width_pt; ++x)
+                a8[y * a8_stride + x] = 255 - image[y * stride + x * 4];
+        }
+        return a8;
+    }
+
+    /**
+     * Thresholds gray RGB24 image from `make_image()` into A1 image with the bit order of cairo
+     * on little-endian machines (first pixel of a byte in its lowest bit). Padding of the rows is
+     * set, cairo doesn't clear it.
+     */
+    std::vector<unsigned char> to_a1(const std::vector<unsigned char>& image, const LabelDimensions& dim,
+            const int a1_stride) {
+        const size_t stride = dim.width_pt * 4;
+        std::vector<unsigned char> a1(static_cast<size_t>(a1_stride) * dim.height_pt, 0xff);
+        for(uint32_t y = 0; y < dim.height_pt; ++y) {
+            for(uint32_t x = 0; x < dim.width_pt; ++x) {
+                if(image[y * stride + x * 4] >= Label::DEFAULT_THRESHOLD)
+                    a1[y * a1_stride + x / 8] &= static_cast<unsigned char>(~(1u << (x % 8)));
+            }
+        }
+        return a1;
+    }
+
+    /**
+     * Times RGB24 conversion of all of the row kernels against the naive conversion and checks
+     * RGB24 and A8 conversions of every kernel and A1 conversion against naive references.
+     *
+     * @return Whether all of the conversions are the same as their references
+     */
+    bool run(const std::string& name, const LabelDimensions& dim) {
+        constexpr RasterConverter::SimdLevel levels[] = {
+                RasterConverter::SimdLevel::SCALAR, RasterConverter::SimdLevel::SSE2, RasterConverter::SimdLevel::AVX2
+        };
+
+        const int stride = static_cast<int>(dim.width_pt * 4);
+        const std::vector<unsigned char> image = make_image(dim, stride);
+        const std::vector<uint8_t> expected = naive_columns(image.data(), stride, dim);
+
+        const int a8_stride = static_cast<int>((dim.width_pt + 3) / 4 * 4);
+        const std::vector<unsigned char> a8_image = to_a8(image, dim, a8_stride);
+        const std::vector<uint8_t> a8_expected = naive_columns(dim, [&](const unsigned column, const unsigned row) {
+            return 255 - a8_image[row * a8_stride + column] < Label::DEFAULT_THRESHOLD;
+        });
+
+        const int a1_stride = static_cast<int>((dim.width_pt + 31) / 32 * 4);
+        const std::vector<unsigned char> a1_image = to_a1(image, dim, a1_stride);
+        const std::vector<uint8_t> a1_expected = naive_columns(dim, [&](const unsigned column, const unsigned row) {
+            return (a1_image[row * a1_stride + column / 8] >> (column % 8)) & 1u;
+        });
+
+        cout << std::left << std::setw(12) << name
+             << std::right << std::setw(6) << dim.width_pt << " x " << std::left << std::setw(6) << dim.height_pt
+             << std::right << std::fixed << std::setprecision(1);
+
+        const double naive_ns = measure_ns([&] {
+            volatile auto size = naive_columns(image.data(), stride, dim).size();
+            (void) size;
+        });
+        cout << std::setw(12) << naive_ns / 1000.0;
+
+        bool identical = true;
+        std::vector<uint8_t> blocked(dim.width_pt * RasterConverter::PACKET_SIZE);
+        for(const auto level: levels) {
+            const auto convert = [&] {
+                RasterConverter::rgb24_to_columns(image.data(), stride, dim.width_pt, dim.height_pt, blocked.data(),
+                        Label::DEFAULT_THRESHOLD, level);
+            };
+
+            convert();
+            identical &= expected == blocked;
+
+            const double blocked_ns = measure_ns(convert);
+            cout << std::setw(12) << blocked_ns / 1000.0 << std::setw(7) << naive_ns / blocked_ns << "x";
+
+            RasterConverter::a8_to_columns(a8_image.data(), a8_stride, dim.width_pt, dim.height_pt, blocked.data(),
+                    Label::DEFAULT_THRESHOLD, level);
+            identical &= a8_expected == blocked;
+        }
+
+        RasterConverter::a1_to_columns(a1_image.data(), a1_stride, dim.width_pt, dim.height_pt, blocked.data());
+        identical &= a1_expected == blocked;
+
+        cout << std::setw(11) << (identical ? "yes" : "NO") << endl;
+        return identical;
+    }
+
+    /**
+     * Compares job headers built once per job and patched for each page with job data messages
+     * built from scratch, for jobs with all of the optional settings.
+     *
+     * @return Whether they are the same
+     */
+    bool run_job_header() {
+        bool identical = true;
+        for(int options = 0; options < 8; ++options) {
+            PrinterJobData job_data(options % 2 == 0 ? LabelFormat::die_cut(LabelSubtypes::DieCut::DC_29x90)
+                    : LabelFormat::continuous_length(LabelSubtypes::ContinuousLength::CL_62, CONTINUOUS_LENGTH_WIDTH_MM));
+            job_data.set_quality(options & 2);
+            job_data.set_compression(options & 4);
+            job_data.set_auto_cut_options(options & 2 ? std::optional<uint8_t>(3) : std::nullopt);
+
+            JobHeader header = job_data.construct_job_header();
+            for(const bool starting_page: {true, false}) {
+                job_data.set_is_starting_page(starting_page);
+                header.set_starting_page(starting_page);
+                identical &= job_data.construct_job_data_message()
+                        == std::vector<uint8_t>(header.data(), header.data() + header.size());
+            }
+        }
+
+        cout << "Job headers patched per page, identical to job data: " << (identical ? "yes" : "NO") << endl;
+        return identical;
+    }
+
+    /**
+     * Converts the longest continuous length label strip by strip the way `Printer::print_streaming()`
+     * sends it and compares the joined messages (raw and compressed) with the message of the whole label.
+     *
+     * @return Whether the messages are the same
+     */
+    bool run_strips(const LabelSubtypes::ContinuousLength subtype, const uint32_t strip_columns) {
+        const LabelFormat format = LabelFormat::continuous_length(subtype, 1000);
+        const LabelDimensions& dim = format.dimensions;
+        const int stride = static_cast<int>(dim.width_pt * 4);
+        const std::vector<unsigned char> image = make_image(dim, stride);
+
+        BufferPool pool {};
+        PrinterJobStatistics statistics {};
+        PageBuilder builder(pool, statistics);
+        const JobHeader header = PrinterJobData(format).construct_job_header();
+
+        bool identical = true;
+        for(const bool compress: {false, true}) {
+            std::vector<uint8_t> printing_data(dim.width_pt * RasterConverter::PACKET_SIZE);
+            RasterConverter::rgb24_to_columns(image.data(), stride, dim.width_pt, dim.height_pt, printing_data.data(),
+                    Label::DEFAULT_THRESHOLD);
+            const std::vector<uint8_t> expected = builder.page(header, std::move(printing_data), true, compress);
+
+            std::vector<uint8_t> joined {};
+            for(uint32_t column = 0; column < dim.width_pt; column += strip_columns) {
+                const uint32_t columns = std::min(strip_columns, dim.width_pt - column);
+                std::vector<uint8_t> strip = pool.acquire(columns * RasterConverter::PACKET_SIZE);
+                RasterConverter::rgb24_to_columns(image.data() + column * 4, stride, columns, dim.height_pt, strip.data(),
+                        Label::DEFAULT_THRESHOLD);
+
+                strip = column == 0 ? builder.first_strip(header, std::move(strip), compress)
+                        : builder.strip_data(std::move(strip), compress);
+                joined.insert(joined.end(), strip.begin(), strip.end());
+                builder.recycle(std::move(strip));
+            }
+            const std::vector<uint8_t> command = builder.page_end(true);
+            joined.insert(joined.end(), command.begin(), command.end());
+
+            identical &= expected == joined;
+        }
+
+        cout << "Strips of " << std::setw(4) << strip_columns << " columns (" << dim.width_pt << " x " << dim.height_pt
+             << "), identical page data: " << (identical ? "yes" : "NO") << endl;
+        return identical;
+    }
+
+    /**
+     * Label with the image from `make_image()`, which needs neither cairo nor label configuration.
+     */
+    class ImageLabel : public Label {
+    private:
+        std::vector<unsigned char> image;
+
+    public:
+        explicit ImageLabel(const LabelFormat& _format)
+            : Label(_format),
+            image(make_image(format.dimensions, static_cast<int>(format.dimensions.width_pt * 4))) {}
+
+        [[nodiscard]] std::vector<uint8_t> get_printing_data() const override {
+            std::vector<uint8_t> printing_data {};
+            rasterize(nullptr, printing_data);
+            return printing_data;
+        }
+
+        using Label::rasterize;
+
+        void rasterize(const RenderedLabel*, std::vector<uint8_t>& printing_data) const override {
+            const LabelDimensions& dim = format.dimensions;
+            printing_data.resize(dim.width_pt * RasterConverter::PACKET_SIZE);
+            RasterConverter::rgb24_to_columns(image.data(), static_cast<int>(dim.width_pt * 4), dim.width_pt,
+                    dim.height_pt, printing_data.data(), threshold);
+        }
+    };
+
+    /**
+     * @return Format of labels printed into `SimulatedPrinter`
+     */
+    LabelFormat simulated_format() {
+        return LabelFormat::continuous_length(LabelSubtypes::ContinuousLength::CL_62, CONTINUOUS_LENGTH_WIDTH_MM);
+    }
+
+    /**
+     * `SimulatedPrinter` to be moved into a `Printer` and a reference to it, which stays valid
+     * as long as the `Printer` lives.
+     */
+    struct SimulatedTransport {
+        std::unique_ptr<SimulatedPrinter> owner;
+        SimulatedPrinter& printer;
+    };
+
+    /**
+     * @param options Options of the printer, its `time_scale` is set to 0 (pages are printed instantly)
+     */
+    SimulatedTransport make_simulated_printer(SimulatedPrinterOptions options = {}) {
+        options.time_scale = 0;
+        auto simulated = std::make_unique<SimulatedPrinter>(options);
+        SimulatedPrinter& printer = *simulated;
+        return {std::move(simulated), printer};
+    }
+
+    /**
+     * Prints jobs through `Printer::print()` into `SimulatedPrinter` once the pools are warmed up and counts
+     * allocations of the whole print loop - pipeline, page messages, transfers and statuses. A job only
+     * allocates to set itself up (worker threads, for example), so a job of twice as many pages must
+     * allocate exactly as much as the shorter one.
+     *
+     * @param send_ahead_window See `Printer::set_send_ahead_window()`
+     * @return Whether the print loop didn't allocate
+     */
+    bool run_steady_state(const size_t send_ahead_window) {
+        const LabelFormat format = simulated_format();
+        ImageLabel label(format);
+        const std::vector<Label*> short_job(ITERATIONS, &label);
+        const std::vector<Label*> long_job(2 * ITERATIONS, &label);
+
+        Printer printer(make_simulated_printer().owner);
+        printer.set_send_ahead_window(send_ahead_window);
+
+        bool steady = true;
+        for(const bool compress: {false, true}) {
+            PrinterJobData job_data(format);
+            job_data.set_compression(compress);
+
+            const auto count_allocations = [&](const std::vector<Label*>& labels) {
+                const size_t before = allocation_count();
+                printer.print(labels, job_data);
+                return allocation_count() - before;
+            };
+
+            // Warms up pools of buffers
+            count_allocations(long_job);
+            count_allocations(long_job);
+
+            const size_t short_allocations = count_allocations(short_job);
+            const size_t long_allocations = count_allocations(long_job);
+            const auto per_page = (static_cast<double>(long_allocations) - static_cast<double>(short_allocations))
+                    / ITERATIONS;
+
+            cout << "Allocations of print loop, window " << send_ahead_window << (compress ? ", compressed" : ", raw       ")
+                 << ": " << per_page << " per page (" << short_allocations << " in " << ITERATIONS << " pages, "
+                 << long_allocations << " in " << 2 * ITERATIONS << " pages)" << endl;
+            steady &= long_allocations == short_allocations;
+        }
+        return steady;
+    }
+
+    /**
+     * Prints a job through the whole print loop of `Printer` into `SimulatedPrinter` (which prints
+     * instantly) and checks what the printer received.
+     *
+     * @param send_ahead_window See `Printer::set_send_ahead_window()`
+     * @param compress Whether page data is compressed
+     * @return Whether all of the pages were printed, the last one is the same as the label and
+     * metrics account for all of them
+     */
+    bool run_simulated(const size_t send_ahead_window, const bool compress) {
+        constexpr size_t PAGES = 20;
+
+        const LabelFormat format = simulated_format();
+        ImageLabel label(format);
+        const std::vector<Label*> labels(PAGES, &label);
+
+        SimulatedPrinterOptions options {};
+        options.cooling_after_pages = 8;
+        auto [simulated, simulated_printer] = make_simulated_printer(options);
+
+        PrinterJobData job_data(format);
+        job_data.set_compression(compress);
+
+        Metrics::reset();
+
+        double elapsed_ms;
+        SimulatedPrinterStatistics statistics;
+        std::vector<uint8_t> last_page_raster;
+        {
+            Printer printer(std::move(simulated));
+            printer.set_send_ahead_window(send_ahead_window);
+
+            const auto start = std::chrono::steady_clock::now();
+            printer.print(labels, job_data);
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            // Simulated printer is owned by `printer`
+            statistics = simulated_printer.get_statistics();
+            last_page_raster = simulated_printer.get_last_page_raster();
+        }
+
+        const std::vector<uint8_t> printing_data = label.get_printing_data();
+        std::vector<uint8_t> expected {};
+        for(size_t i = 0; i < printing_data.size(); i += RasterConverter::PACKET_SIZE) {
+            expected.insert(expected.end(), printing_data.begin() + i + RasterConverter::COMMAND_SIZE,
+                    printing_data.begin() + i + RasterConverter::PACKET_SIZE);
+        }
+
+        const bool identical = statistics.pages == PAGES && statistics.raster_lines == PAGES * format.dimensions.width_pt
+                && last_page_raster == expected;
+        const bool counted = Metrics::get_counter(PrintCounter::LABELS_PRINTED) == PAGES
+                && Metrics::get_counter(PrintCounter::COOLING_EVENTS) == statistics.cooling_periods
+                && Metrics::get_counter(PrintCounter::BYTES_SENT) == statistics.received_bytes
+                && Metrics::get_histogram(PrintStage::RENDER).get_count() == PAGES
+                && Metrics::get_histogram(PrintStage::RASTERIZE).get_count() == PAGES
+                && Metrics::get_histogram(PrintStage::PRINT_WAIT).get_count() == PAGES;
+
+        cout << "Simulated job, window " << send_ahead_window << (compress ? ", compressed" : ", raw       ")
+             << ": " << statistics.pages << " pages, " << statistics.received_bytes << " bytes, "
+             << std::setprecision(2) << PAGES / elapsed_ms * 1000 << " pages/s, printed as sent: "
+             << (identical ? "yes" : "NO") << ", p99 send " << std::setprecision(3)
+             << Metrics::get_histogram(PrintStage::USB_SEND).quantile(0.99) * 1e6 << " us, counted: "
+             << (counted ? "yes" : "NO") << endl;
+        return identical && counted;
+    }
+
+    /**
+     * `ImageLabel` which takes `RASTERIZE_DELAY` to rasterize, so that statuses of the printer come before it is sent.
+     */
+    class SlowImageLabel : public ImageLabel {
+    public:
+        static constexpr std::chrono::milliseconds RASTERIZE_DELAY {50};
+
+        using ImageLabel::ImageLabel;
+        using ImageLabel::rasterize;
+
+        void rasterize(const RenderedLabel *rendered, std::vector<uint8_t>& printing_data) const override {
+            std::this_thread::sleep_for(RASTERIZE_DELAY);
+            ImageLabel::rasterize(rendered, printing_data);
+        }
+    };
+
+    /**
+     * Lets `SimulatedPrinter` fail in the middle of a job sent ahead. Pages after the failing one are
+     * rasterized slowly, so the window isn't full when the printer reports the error.
+     *
+     * @return Whether `Printer::print()` reported the error and sent no page after it
+     */
+    bool run_simulated_error() {
+        constexpr size_t FAST_PAGES = 2;
+
+        const LabelFormat format = simulated_format();
+        ImageLabel label(format);
+        SlowImageLabel slow_label(format);
+        std::vector<Label*> labels(10, &slow_label);
+        std::fill_n(labels.begin(), FAST_PAGES, &label);
+
+        SimulatedPrinterOptions options {};
+        options.error_at_page = FAST_PAGES;
+        auto [simulated, simulated_printer] = make_simulated_printer(options);
+
+        std::string error {};
+        SimulatedPrinterStatistics statistics;
+        {
+            Printer printer(std::move(simulated));
+            printer.set_send_ahead_window(4);
+            try {
+                printer.print(labels, PrinterJobData(format));
+            }
+            catch(const PrinterError& e) {
+                error = e.error;
+            }
+            statistics = simulated_printer.get_statistics();
+        }
+
+        cout << "Simulated error at page " << options.error_at_page << ": "
+             << (error.empty() ? "NOT REPORTED" : error) << ", " << statistics.rejected_pages
+             << " pages sent after it" << endl;
+        return error == PrinterStatus::error_type_codes.at(options.error)
+                && Metrics::get_counter(PrintCounter::PRINTER_ERRORS) > 0 && statistics.rejected_pages == 0;
+    }
+
+    /**
+     * Prints labels created one at a time by a `LabelSource` into `SimulatedPrinter`.
+     *
+     * @param send_ahead_window See `Printer::set_send_ahead_window()`
+     * @return Whether all of the pages were printed, no more than the labels in flight of the pipeline
+     * were alive at once and printing started before the source ran out
+     */
+    bool run_label_source(const size_t send_ahead_window) {
+        constexpr size_t PAGES = 20;
+
+        const LabelFormat format = simulated_format();
+        PrintPipelineOptions pipeline_options {};
+
+        auto [simulated, simulated_printer] = make_simulated_printer();
+
+        Metrics::reset();
+
+        // Deleter of labels runs on a worker thread of the pipeline
+        std::atomic<size_t> alive {0};
+        size_t created = 0;
+        size_t max_alive = 0;
+        uint64_t printed_before_last = 0;
+        const LabelSource source = [&]() -> std::shared_ptr<const Label> {
+            if(created == PAGES)
+                return nullptr;
+            if(++created == PAGES)
+                printed_before_last = Metrics::get_counter(PrintCounter::LABELS_PRINTED);
+
+            max_alive = std::max(max_alive, ++alive);
+            return std::shared_ptr<const Label>(new ImageLabel(format), [&alive](const Label *label) {
+                --alive;
+                delete label;
+            });
+        };
+
+        SimulatedPrinterStatistics statistics;
+        {
+            Printer printer(std::move(simulated));
+            printer.set_pipeline_options(pipeline_options);
+            printer.set_send_ahead_window(send_ahead_window);
+            printer.print(source, PrinterJobData(format));
+            statistics = simulated_printer.get_statistics();
+        }
+
+        const bool printed = statistics.pages == PAGES && alive == 0;
+        const bool bounded = max_alive <= pipeline_options.max_in_flight;
+        const bool started = printed_before_last > 0;
+
+        cout << "Label source, window " << send_ahead_window << ": " << statistics.pages << " pages, at most "
+             << max_alive << " labels alive, " << printed_before_last << " printed before the last one was created"
+             << endl;
+        return printed && bounded && started;
+    }
+
+    /**
+     * Prints jobs with `PrinterPool` of two `SimulatedPrinter`s, one of which fails every job.
+     *
+     * @return Whether the working printer printed all of the jobs and failures of the other one were counted
+     */
+    bool run_pool_failover() {
+        constexpr size_t JOBS = 6;
+        constexpr size_t LABELS_PER_JOB = 2;
+
+        const LabelFormat format = simulated_format();
+        ImageLabel label(format);
+
+        SimulatedPrinterOptions failing_options {};
+        failing_options.error_at_page = 1;
+        failing_options.persistent_error = true;
+        auto [working, working_printer] = make_simulated_printer();
+
+        std::vector<std::unique_ptr<Printer>> printers {};
+        printers.push_back(std::make_unique<Printer>(make_simulated_printer(failing_options).owner));
+        printers.push_back(std::make_unique<Printer>(std::move(working)));
+
+        size_t printed = 0;
+        size_t failures;
+        SimulatedPrinterStatistics statistics;
+        {
+            PrinterPool pool(std::move(printers));
+            std::vector<std::future<PrinterJobStatistics>> results {};
+            for(size_t i = 0; i < JOBS; ++i)
+                results.push_back(pool.submit({std::vector<Label*>(LABELS_PER_JOB, &label), PrinterJobData(format), ""}));
+
+            for(auto& result: results) {
+                try {
+                    printed += result.get().pages;
+                }
+                catch(const PrinterError&) {}
+                catch(const USBError&) {}
+            }
+            failures = pool.get_status()[0].consecutive_failures;
+            statistics = working_printer.get_statistics();
+        }
+
+        cout << "Printer pool with a failing printer: " << printed << " of " << JOBS * LABELS_PER_JOB
+             << " pages printed, " << failures << " failed jobs in a row" << endl;
+        return printed == JOBS * LABELS_PER_JOB && statistics.pages == printed && failures > 0;
+    }
+
+    /**
+     * Prepares printing data of a batch of labels of different sizes with `BatchRenderer` on 1, 2, 4 and
+     * all of the hardware threads and compares it with printing data prepared one label after another.
+     *
+     * @return Whether all of the thread counts gave the same printing data in the same order
+     */
+    bool run_batch_renderer() {
+        constexpr size_t LABELS = 48;
+        const LabelFormat formats[] = {
+                LabelFormat::die_cut(LabelSubtypes::DieCut::DC_62x100),
+                LabelFormat::die_cut(LabelSubtypes::DieCut::DC_29x90),
+                LabelFormat::continuous_length(LabelSubtypes::ContinuousLength::CL_62, CONTINUOUS_LENGTH_WIDTH_MM)
+        };
+
+        std::vector<std::unique_ptr<ImageLabel>> owned {};
+        std::vector<Label*> labels {};
+        for(size_t i = 0; i < LABELS; ++i) {
+            owned.push_back(std::make_unique<ImageLabel>(formats[i % std::size(formats)]));
+            labels.push_back(owned.back().get());
+        }
+
+        std::vector<std::vector<uint8_t>> expected {};
+        for(const Label *label: labels)
+            expected.push_back(label->get_printing_data());
+
+        std::vector<size_t> thread_counts {1, 2, 4, std::max(1u, std::thread::hardware_concurrency())};
+        std::sort(thread_counts.begin(), thread_counts.end());
+        thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+        bool identical = true;
+        double single_thread_rate = 0;
+        for(const size_t threads: thread_counts) {
+            BatchRenderer renderer(threads);
+
+            // Best of a few batches, so that a preempted batch doesn't spoil the scaling
+            double best_s = 0;
+            for(int i = 0; i < 3; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                const std::vector<std::vector<uint8_t>> printing_data = renderer.render(labels);
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                identical &= printing_data == expected;
+                best_s = i == 0 ? elapsed.count() : std::min(best_s, elapsed.count());
+            }
+
+            const double rate = LABELS / best_s;
+            if(threads == 1)
+                single_thread_rate = rate;
+            cout << "Batch of " << LABELS << " labels, " << std::setw(2) << renderer.get_thread_count() << " threads: "
+                 << std::setprecision(0) << rate << " labels/s (" << std::setprecision(2) << rate / single_thread_rate
+                 << "x of 1 thread), identical to serial: " << (identical ? "yes" : "NO") << endl;
+        }
+        return identical;
+    }
+
+    /**
+     * Traces a job printed into `SimulatedPrinter`.
+     *
+     * @return Whether the trace has spans of all of the stages of the job
+     */
+    bool run_traced() {
+        const LabelFormat format = simulated_format();
+        ImageLabel label(format);
+
+        Tracer::start();
+        {
+            Printer printer(make_simulated_printer().owner);
+            printer.print(std::vector<Label*>(3, &label), PrinterJobData(format));
+        }
+        std::ostringstream trace;
+        Tracer::write_chrome_trace(trace);
+        Tracer::stop();
+
+        bool complete = true;
+        for(const char *span: {"print_job", "render", "rasterize", "bulk_transfer", "status"})
+            complete &= trace.str().find(std::string("\"name\":\"") + span + "\"") != std::string::npos;
+
+        cout << "Traced job: " << trace.str().size() << " bytes of trace, all stages: " << (complete ? "yes" : "NO")
+             << endl;
+        return complete;
+    }
+
+    /**
+     * Connection to `PrintDaemon`, which sends requests and reads responses line by line.
+     */
+    class DaemonClient {
+    private:
+        static constexpr timeval RECEIVE_TIMEOUT {5, 0};  /**< So that a daemon which doesn't answer fails the check */
+
+        int fd;
+        std::string received {};
+
+    public:
+        explicit DaemonClient(const std::string& socket_path) : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+            sockaddr_un address {};
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &RECEIVE_TIMEOUT, sizeof(RECEIVE_TIMEOUT));
+            if(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+                throw std::runtime_error("Connecting to " + socket_path + " failed: " + std::strerror(errno));
+        }
+
+        ~DaemonClient() noexcept {
+            close(fd);
+        }
+
+        DaemonClient(const DaemonClient&) = delete;
+        DaemonClient& operator=(const DaemonClient&) = delete;
+
+        void send_text(const std::string& text) {
+            send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+        }
+
+        /**
+         * @return The next line without the newline, or an empty string if the daemon closed the
+         * connection or didn't send a whole line in `RECEIVE_TIMEOUT`
+         */
+        std::string receive_line() {
+            size_t end;
+            while((end = received.find('\n')) == std::string::npos) {
+                char buffer[256];
+                const ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+                if(length <= 0)
+                    return "";
+                received.append(buffer, length);
+            }
+
+            std::string line = received.substr(0, end);
+            received.erase(0, end + 1);
+            return line;
+        }
+
+        std::string request(const std::string& request) {
+            send_text(request + "\n");
+            return receive_line();
+        }
+    };
+
+    /**
+     * Runs `PrintDaemon` with `SimulatedPrinter` and sends it requests over its socket - valid and invalid
+     * ones, while another client stops in the middle of a request.
+     *
+     * @return Whether all of the requests were answered as expected, the stopped client didn't hold up the
+     * other one and it was disconnected after the idle timeout
+     */
+    bool run_daemon() {
+        constexpr std::chrono::milliseconds CLIENT_TIMEOUT {300};
+
+        const std::string socket_path = (std::filesystem::temp_directory_path() / "raster_benchmark_daemon.sock").string();
+        auto [simulated, simulated_printer] = make_simulated_printer();
+
+        PrintDaemonOptions options {};
+        options.socket_path = socket_path;
+        options.config_file = CONFIG_FILE;
+        options.definitions_file = DEFINITIONS_FILE;
+        options.format = simulated_format();
+        options.transport = std::move(simulated);
+        options.client_timeout = CLIENT_TIMEOUT;
+
+        PrintDaemon daemon(std::move(options));
+        std::thread server([&daemon] { daemon.run(); });
+
+        const std::vector<std::pair<std::string, std::string>> requests {
+                {"PRINT prep 2 Ketchup", "OK 2 "},
+                {"PRINT prep 0 Ketchup", "ERR Number of copies"},
+                {"PRINT prep two Ketchup", "ERR Usage: "},
+                {"PRINT lunch 1 Ketchup", "ERR Unknown usage: lunch"},
+                {"PRINT storage 1 Jalapenos", "ERR Unknown label: Jalapenos (storage)"},
+                {"RELOAD", "OK "},
+                {"STATUS", "ERR Unknown command: STATUS"}
+        };
+
+        bool answered = true;
+        std::chrono::duration<double, std::milli> idle_ms {};
+        {
+            DaemonClient client(socket_path);
+            for(const auto& [request, expected]: requests) {
+                const std::string response = client.request(request);
+                if(response.rfind(expected, 0) != 0) {
+                    cout << "Daemon answered " << request << " with: " << response << endl;
+                    answered = false;
+                }
+            }
+
+            // Stopped client doesn't hold up the others and it is disconnected once it is idle for too long
+            DaemonClient stopped(socket_path);
+            const auto stopped_at = std::chrono::steady_clock::now();
+            stopped.send_text("PRINT prep 1 Ket");
+            answered &= client.request("PRINT prep 1 Ketchup").rfind("OK 1 ", 0) == 0;
+
+            const bool disconnected = stopped.receive_line().empty();
+            idle_ms = std::chrono::steady_clock::now() - stopped_at;
+            answered &= disconnected && idle_ms >= CLIENT_TIMEOUT;
+        }
+
+        daemon.stop();
+        server.join();
+
+        const size_t pages = simulated_printer.get_statistics().pages;
+        cout << "Print daemon: " << requests.size() + 1 << " requests answered as expected: " << (answered ? "yes" : "NO")
+             << ", " << pages << " pages printed, stopped client disconnected after " << std::setprecision(0)
+             << idle_ms.count() << " ms" << endl;
+        return answered && pages == 3;
+    }
+}
+
+int main() {
+    // Printer logs every job and the simulated runs would drown the results
+    Logger::set_level(LogLevel::WARNING);
+
+    cout << "Detected SIMD level: " << static_cast<int>(RasterConverter::detect_simd_level())
+         << " (0 - scalar, 1 - SSE2, 2 - AVX2)" << endl << endl;
+
+    cout << std::left << std::setw(12) << "Subtype" << std::setw(15) << "Size [pt]"
+         << std::right << std::setw(12) << "Naive [us]"
+         << std::setw(20) << "Scalar [us]" << std::setw(20) << "SSE2 [us]" << std::setw(20) << "AVX2 [us]"
+         << std::setw(11) << "Identical" << endl;
+
+    bool ok = true;
+    for(const auto& [subtype, dim]: LabelSubtypes::__continuous_length_dimensions) {
+        LabelDimensions continuous = dim;
+        continuous.width_mm = CONTINUOUS_LENGTH_WIDTH_MM;
+        continuous.width_pt = static_cast<uint32_t>(std::round(CONTINUOUS_LENGTH_WIDTH_MM * 0.03937 * 300));
+        ok &= run("CL_" + std::to_string(dim.height_mm), continuous);
+    }
+
+    for(const auto& [subtype, dim]: LabelSubtypes::__die_cut_dimensions)
+        ok &= run("DC_" + std::to_string(dim.height_mm) + "x" + std::to_string(dim.width_mm), dim);
+
+    cout << endl;
+    ok &= run_job_header();
+
+    for(const uint32_t strip_columns: {100u, 256u})
+        ok &= run_strips(LabelSubtypes::ContinuousLength::CL_62, strip_columns);
+
+    cout << endl;
+    ok &= run_batch_renderer();
+
+    cout << endl;
+    for(const size_t send_ahead_window: {1u, 4u}) {
+        for(const bool compress: {false, true})
+            ok &= run_simulated(send_ahead_window, compress);
+    }
+    ok &= run_simulated_error();
+    ok &= run_pool_failover();
+    for(const size_t send_ahead_window: {1u, 4u})
+        ok &= run_steady_state(send_ahead_window);
+    for(const size_t send_ahead_window: {1u, 4u})
+        ok &= run_label_source(send_ahead_window);
+    ok &= run_traced();
+
+    cout << endl;
+    ok &= run_daemon();
+
+    return ok ? 0 : 1;
+}
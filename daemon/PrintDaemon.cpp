@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "PrintDaemon.h"
+#include "../label/ProductLabelCreator.h"
+#include "../exceptions/PrinterError.h"
+#include "../exceptions/USBError.h"
+#include "../utils/Logger.h"
+
+namespace {
+    constexpr unsigned MAX_COPIES = 1000;
+
+    const std::map<std::string, ProductUsage> __usages {
+            {"board", ProductUsage::BOARD},
+            {"prep", ProductUsage::PREP},
+            {"storage", ProductUsage::STORAGE}
+    };
+
+    std::runtime_error socket_error(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+}
+
+PrintDaemon::PrintDaemon(PrintDaemonOptions _options)
+    : options(std::move(_options)),
+    running(true) {
+    load_labels();
+
+    const bool scan = options.transport == nullptr;
+    printer = scan ? std::make_unique<Printer>() : std::make_unique<Printer>(std::move(options.transport));
+    printer->set_async_transfers(options.async_transfers);
+    printer->set_send_ahead_window(options.send_ahead_window);
+    if(scan)
+        printer->scan_for_printer();
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if(options.socket_path.empty() || options.socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Invalid socket path: " + options.socket_path);
+    std::strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server_fd < 0)
+        throw socket_error("Creating socket failed");
+
+    unlink(options.socket_path.c_str());
+    if(bind(server_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+            || listen(server_fd, SOMAXCONN) < 0) {
+        const std::runtime_error error = socket_error("Listening on " + options.socket_path + " failed");
+        close(server_fd);
+        throw error;
+    }
+
+    Logger::info("Listening on ", options.socket_path);
+
+    if(options.metrics.enabled())
+        metrics_exporter = std::make_unique<MetricsExporter>(options.metrics);
+}
+
+PrintDaemon::~PrintDaemon() noexcept {
+    for(const Client& client: clients)
+        close(client.fd);
+
+    if(server_fd >= 0) {
+        close(server_fd);
+        unlink(options.socket_path.c_str());
+    }
+}
+
+void PrintDaemon::load_labels() {
+    ProductLabelCreator::load_config(options.config_file);
+
+    std::map<LabelKey, std::shared_ptr<Label>> loaded {};
+    for(auto& label: ProductLabel::load_label_definitions(options.definitions_file, options.format)) {
+        const auto *product = dynamic_cast<const ProductLabel*>(label.get());
+        loaded[{product->get_name(), product->get_usage()}] = std::move(label);
+    }
+
+    labels = std::move(loaded);
+    Logger::info("Loaded ", labels.size(), " labels");
+}
+
+void PrintDaemon::run() {
+    std::vector<pollfd> fds {};
+
+    while(running) {
+        // The socket comes first, then clients in the same order as in `clients`
+        fds.clear();
+        fds.push_back({server_fd, POLLIN, 0});
+        for(const Client& client: clients)
+            fds.push_back({client.fd, POLLIN, 0});
+
+        if(poll(fds.data(), fds.size(), static_cast<int>(POLL_INTERVAL.count())) < 0) {
+            if(errno == EINTR)
+                continue;
+            throw socket_error("Waiting for clients failed");
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < clients.size() && running; ++i) {
+            Client& client = clients[i];
+            if(fds[i + 1].revents != 0)
+                serve_client(client);
+            else if(now - client.last_active > options.client_timeout) {
+                Logger::info("Disconnecting idle client");
+                client.open = false;
+            }
+
+            if(!client.open)
+                close(client.fd);
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& c) { return !c.open; }),
+                clients.end());
+
+        if((fds[0].revents & POLLIN) != 0 && running)
+            accept_client();
+    }
+}
+
+void PrintDaemon::accept_client() {
+    const int client_fd = accept(server_fd, nullptr, nullptr);
+    if(client_fd < 0) {
+        if(errno == EINTR || errno == ECONNABORTED || !running)
+            return;
+        throw socket_error("Accepting client failed");
+    }
+
+    if(clients.size() >= MAX_CLIENTS) {
+        const std::string response = "ERR Too many clients\n";
+        send(client_fd, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(client_fd);
+        return;
+    }
+
+    // Responses are short, but a client which doesn't read them would block sending
+    const auto timeout_ms = options.client_timeout.count();
+    const timeval timeout {static_cast<time_t>(timeout_ms / 1000), static_cast<suseconds_t>(timeout_ms % 1000 * 1000)};
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    clients.push_back({client_fd, {}, std::chrono::steady_clock::now()});
+}
+
+void PrintDaemon::stop() noexcept {
+    running = false;
+    shutdown(server_fd, SHUT_RDWR);  // Wakes up `accept()`
+}
+
+void PrintDaemon::serve_client(Client& client) {
+    char buffer[512];
+
+    const ssize_t received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if(received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+    if(received <= 0) {
+        client.open = false;
+        return;
+    }
+    client.pending.append(buffer, received);
+    client.last_active = std::chrono::steady_clock::now();
+
+    size_t end;
+    while(running && (end = client.pending.find('\n')) != std::string::npos) {
+        std::string request = client.pending.substr(0, end);
+        client.pending.erase(0, end + 1);
+        if(!request.empty() && request.back() == '\r')
+            request.pop_back();
+
+        const std::string response = handle_request(request) + "\n";
+        if(send(client.fd, response.data(), response.size(), MSG_NOSIGNAL) < 0) {
+            client.open = false;
+            return;
+        }
+        // Printing can take long, the client isn't idle while it waits for the response
+        client.last_active = std::chrono::steady_clock::now();
+    }
+
+    if(client.pending.size() > MAX_REQUEST_SIZE) {
+        const std::string response = "ERR Request too long\n";
+        send(client.fd, response.data(), response.size(), MSG_NOSIGNAL);
+        client.open = false;
+    }
+}
+
+std::string PrintDaemon::handle_request(const std::string& request) {
+    const size_t command_end = request.find(' ');
+    const std::string command = request.substr(0, command_end);
+    const std::string arguments = command_end == std::string::npos ? "" : request.substr(command_end + 1);
+
+    try {
+        if(command == "PRINT")
+            return print(arguments);
+        if(command == "RELOAD") {
+            load_labels();
+            return "OK " + std::to_string(labels.size());
+        }
+        return "ERR Unknown command: " + command;
+    }
+    catch(const PrinterError& e) {
+        return "ERR " + e.error;
+    }
+    catch(const USBError& e) {
+        return "ERR " + e.error + " (" + e.where + ")";
+    }
+    catch(const std::exception& e) {
+        return std::string("ERR ") + e.what();
+    }
+}
+
+std::string PrintDaemon::print(const std::string& arguments) {
+    std::istringstream stream(arguments);
+    std::string usage_str {};
+    unsigned copies = 0;
+    std::string name {};
+
+    stream >> usage_str >> copies;
+    stream.get();  // Space before the name, which can contain spaces itself
+    std::getline(stream, name);
+    if(!stream && !stream.eof())
+        return "ERR Usage: PRINT <usage> <copies> <product name>";
+
+    const auto usage_it = __usages.find(usage_str);
+    if(usage_it == __usages.end())
+        return "ERR Unknown usage: " + usage_str;
+    if(copies == 0 || copies > MAX_COPIES)
+        return "ERR Number of copies must be in range <1, " + std::to_string(MAX_COPIES) + ">";
+
+    const auto label_it = labels.find({name, usage_it->second});
+    if(label_it == labels.end())
+        return "ERR Unknown label: " + name + " (" + usage_str + ")";
+
+    PrinterJobData job_data(options.format);
+    job_data.set_quality(true);
+    job_data.set_cut_at_end(true);
+
+    const std::vector<Label*> job_labels(copies, label_it->second.get());
+    try {
+        printer->print(job_labels, job_data);
+    }
+    catch(const USBError&) {
+        if(printer->is_connected())
+            throw;
+
+        // Printer was unplugged or switched off - the request waits until it is back and is printed again
+        Logger::warning("Printer disconnected, waiting for it...");
+        while(!printer->reconnect(RECONNECT_INTERVAL)) {
+            if(!running)
+                throw;
+        }
+        printer->print(job_labels, job_data);
+    }
+
+    const PrinterJobStatistics& statistics = printer->get_job_statistics();
+    return "OK " + std::to_string(statistics.pages) + " " + std::to_string(statistics.sent_bytes);
+}
@@ -0,0 +1,125 @@
+#ifndef LABEL_PRINTER_DRIVER_PRINTDAEMON_H
+#define LABEL_PRINTER_DRIVER_PRINTDAEMON_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../printer/Printer.h"
+#include "../label/ProductLabel.h"
+#include "../utils/MetricsExporter.h"
+
+struct PrintDaemonOptions {
+    std::string socket_path;
+    std::string config_file;  /**< Label layout (see `ProductLabelCreator::load_config()`) */
+    std::string definitions_file;  /**< Products (see `ProductLabel::load_label_definitions()`) */
+    LabelFormat format;  /**< Media format of all printed labels */
+
+    bool async_transfers = false;  /**< @see Printer::set_async_transfers() */
+    size_t send_ahead_window = 1;  /**< @see Printer::set_send_ahead_window() */
+    MetricsExporterOptions metrics {};  /**< Where metrics are exported, nowhere by default */
+
+    /** Connection to the printer (e.g. `SimulatedPrinter`), the first USB printer found is used if it's not set */
+    std::unique_ptr<Transport> transport {};
+    /** Idle clients are disconnected after this long, it also limits sending of a response */
+    std::chrono::milliseconds client_timeout {30000};
+};
+
+/**
+ * Long-running print server which keeps the printer session (libusb context and claimed
+ * device), the label layout and the label definitions loaded, and takes print requests
+ * over a Unix domain socket. A request pays only for rendering and transfer of its labels.
+ *
+ * Requests are lines of text, each of them answered with a single line:
+ *
+ *     PRINT <usage> <copies> <product name>   ->  OK <pages> <sent bytes>
+ *     RELOAD                                  ->  OK <number of labels>
+ *
+ * where usage is one of `board`, `prep` and `storage`. Failed requests are answered with
+ * `ERR <message>`. A client can send any number of requests over one connection. Requests are
+ * handled one at a time (there is only one printer), but connections are multiplexed, so a client
+ * which stops in the middle of a request doesn't hold up the others - it is disconnected once it
+ * is idle for `PrintDaemonOptions::client_timeout`. If the printer is disconnected while printing, the request waits
+ * until it is connected again and is printed from the start.
+ *
+ * Latencies of print stages and throughput counters (see `Metrics`) can be exported for
+ * Prometheus to a file or another socket (see `PrintDaemonOptions::metrics`).
+ */
+class PrintDaemon {
+private:
+    using LabelKey = std::pair<std::string, ProductUsage>;
+
+    /**
+     * Connection of a client and the part of its request received so far.
+     */
+    struct Client {
+        int fd = -1;
+        std::string pending {};
+        std::chrono::steady_clock::time_point last_active {};
+        bool open = true;
+    };
+
+    static constexpr size_t MAX_REQUEST_SIZE = 1024;
+    static constexpr size_t MAX_CLIENTS = 32;
+    static constexpr std::chrono::milliseconds POLL_INTERVAL {500};
+    static constexpr std::chrono::milliseconds RECONNECT_INTERVAL {500};
+
+    PrintDaemonOptions options;
+    std::unique_ptr<Printer> printer;
+    std::map<LabelKey, std::shared_ptr<Label>> labels;
+
+    int server_fd = -1;
+    std::vector<Client> clients {};
+    std::atomic<bool> running;
+    std::unique_ptr<MetricsExporter> metrics_exporter;
+
+    /**
+     * Loads label layout and label definitions again.
+     */
+    void load_labels();
+
+    void accept_client();
+
+    /**
+     * Reads what the client has sent (without blocking) and answers its complete requests.
+     * Closes the connection if the client closed it, failed or sent too long request.
+     */
+    void serve_client(Client& client);
+    [[nodiscard]] std::string handle_request(const std::string& request);
+    [[nodiscard]] std::string print(const std::string& arguments);
+
+public:
+    /**
+     * Loads labels, connects to the printer (waits until it is connected, unless the options
+     * give a transport) and starts listening on the socket (an existing file at its path is replaced).
+     *
+     * @throws std::runtime_error if labels can't be loaded or the socket can't be set up
+     * @throws USBError if the printer can't be opened
+     */
+    explicit PrintDaemon(PrintDaemonOptions options);
+
+    /**
+     * Closes connections of clients, closes and removes the socket. Printer session is closed by `Printer`.
+     */
+    ~PrintDaemon() noexcept;
+
+    PrintDaemon(const PrintDaemon&) = delete;
+    PrintDaemon& operator=(const PrintDaemon&) = delete;
+
+    /**
+     * Accepts clients and serves their requests until `stop()` is called.
+     */
+    void run();
+
+    /**
+     * Makes `run()` return after the current request. Safe to call from a signal handler.
+     */
+    void stop() noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_PRINTDAEMON_H
@@ -0,0 +1,78 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PrintDaemon.h"
+#include "../utils/Tracer.h"
+
+namespace {
+    PrintDaemon *daemon_instance = nullptr;
+
+    void on_signal(int) {
+        if(daemon_instance != nullptr)
+            daemon_instance->stop();
+    }
+
+    LabelFormat continuous_length_format(const int tape_mm, const int width_mm) {
+        for(const auto& [subtype, dim]: LabelSubtypes::__continuous_length_dimensions) {
+            if(dim.height_mm == tape_mm)
+                return LabelFormat::continuous_length(subtype, width_mm);
+        }
+        throw std::invalid_argument("Unsupported tape width: " + std::to_string(tape_mm) + "mm");
+    }
+}
+
+/*
+Usage: label_printer_daemon <socket> <label_conf.yml> <label_def.yml> [tape mm] [label width mm]
+        [--metrics-file <file>] [--metrics-socket <socket>]
+
+Labels are printed on continuous length tape (29mm by default), 40mm long by default.
+See `PrintDaemon` for the request format. Metrics are exported in Prometheus text format
+to a file (rewritten every 10 seconds) and/or served on another socket. With LABEL_PRINTER_TRACE=<file>
+spans of all of the jobs are written as a Chrome trace when the daemon stops (see `Tracer`).
+*/
+int main(int argc, char *argv[]) {
+    PrintDaemonOptions options {};
+    std::vector<std::string> arguments {};
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if(arg == "--metrics-file" && i + 1 < argc)
+            options.metrics.file_path = argv[++i];
+        else if(arg == "--metrics-socket" && i + 1 < argc)
+            options.metrics.socket_path = argv[++i];
+        else
+            arguments.push_back(arg);
+    }
+
+    if(arguments.size() < 3) {
+        std::cerr << "Usage: " << argv[0] << " <socket> <label_conf.yml> <label_def.yml> [tape mm] [label width mm]"
+                  << " [--metrics-file <file>] [--metrics-socket <socket>]" << std::endl;
+        return 2;
+    }
+
+    options.socket_path = arguments[0];
+    options.config_file = arguments[1];
+    options.definitions_file = arguments[2];
+    options.format = continuous_length_format(arguments.size() > 3 ? std::stoi(arguments[3]) : 29,
+            arguments.size() > 4 ? std::stoi(arguments[4]) : 40);
+
+    Tracer::start_from_environment();
+
+    PrintDaemon print_daemon(std::move(options));
+    daemon_instance = &print_daemon;
+
+    // Without SA_RESTART, so that blocking calls of the daemon are interrupted
+    struct sigaction action {};
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    print_daemon.run();
+
+    daemon_instance = nullptr;
+    Tracer::stop();
+    return 0;
+}
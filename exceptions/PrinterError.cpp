@@ -1,6 +1,6 @@
 #include "PrinterError.h"
-#include <iostream>
+#include "../utils/Logger.h"
 
 PrinterError::PrinterError(std::string error) noexcept : error(std::move(error)) {
-    std::cerr << "Printer error: " << this->error << std::endl;
+    Logger::error("Printer error: ", this->error);
 }
@@ -1,7 +1,7 @@
 #include "USBError.h"
-#include <iostream>
+#include "../utils/Logger.h"
 #include <utility>
 
 USBError::USBError(std::string error, std::string where) noexcept : where(std::move(where)), error(std::move(error))  {
-    std::cerr << "Libusb error: " << this->error << " -- Where: " << this->where << std::endl;
+    Logger::error("Libusb error: ", this->error, " -- Where: ", this->where);
 }
@@ -0,0 +1,26 @@
+#include "BatchRenderer.h"
+
+BatchRenderer::BatchRenderer(const size_t threads) : pool(threads) {}
+
+std::vector<std::vector<uint8_t>> BatchRenderer::render(const std::vector<Label*>& labels) {
+    std::vector<std::future<std::vector<uint8_t>>> pending {};
+    pending.reserve(labels.size());
+
+    for(const Label *label: labels)
+        pending.push_back(pool.submit([label] { return label->get_printing_data(); }));
+
+    // All futures are waited for before the first exception is rethrown, so no task outlives `labels`
+    for(auto& result: pending)
+        result.wait();
+
+    std::vector<std::vector<uint8_t>> printing_data {};
+    printing_data.reserve(labels.size());
+    for(auto& result: pending)
+        printing_data.push_back(result.get());
+
+    return printing_data;
+}
+
+size_t BatchRenderer::get_thread_count() const noexcept {
+    return pool.size();
+}
@@ -0,0 +1,40 @@
+#ifndef LABEL_PRINTER_DRIVER_BATCHRENDERER_H
+#define LABEL_PRINTER_DRIVER_BATCHRENDERER_H
+
+#include <vector>
+
+#include "Label.h"
+#include "../utils/ThreadPool.h"
+
+/**
+ * Prepares printing data of many labels at once, spreading the work
+ * over a pool of threads.
+ *
+ * Labels are rendered concurrently, so `Label::get_printing_data()` must be
+ * thread-safe (it is for `ProductLabel`).
+ */
+class BatchRenderer {
+private:
+    ThreadPool pool;
+
+public:
+    /**
+     * @param threads Number of rendering threads, `0` means one thread per hardware thread
+     */
+    explicit BatchRenderer(size_t threads = 0);
+
+    /**
+     * Prepares printing data of all labels. Blocks until all of them are ready.
+     *
+     * @param labels Labels to render
+     * @return Printing data in the same order as `labels`
+     *
+     * @throws Any exception thrown while rendering one of the labels
+     */
+    [[nodiscard]] std::vector<std::vector<uint8_t>> render(const std::vector<Label*>& labels);
+
+    [[nodiscard]] size_t get_thread_count() const noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_BATCHRENDERER_H
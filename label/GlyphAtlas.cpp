@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GlyphAtlas.h"
+#include "RasterConverter.h"
+
+namespace {
+    std::string encode_utf8(const char32_t code_point) {
+        std::string text {};
+        if(code_point < 0x80) {
+            text += static_cast<char>(code_point);
+        }
+        else if(code_point < 0x800) {
+            text += static_cast<char>(0xc0u | (code_point >> 6u));
+            text += static_cast<char>(0x80u | (code_point & 0x3fu));
+        }
+        else if(code_point < 0x10000) {
+            text += static_cast<char>(0xe0u | (code_point >> 12u));
+            text += static_cast<char>(0x80u | ((code_point >> 6u) & 0x3fu));
+            text += static_cast<char>(0x80u | (code_point & 0x3fu));
+        }
+        else {
+            text += static_cast<char>(0xf0u | (code_point >> 18u));
+            text += static_cast<char>(0x80u | ((code_point >> 12u) & 0x3fu));
+            text += static_cast<char>(0x80u | ((code_point >> 6u) & 0x3fu));
+            text += static_cast<char>(0x80u | (code_point & 0x3fu));
+        }
+        return text;
+    }
+}
+
+GlyphAtlas::GlyphAtlas(std::string _face, const cairo_font_slant_t _slant, const cairo_font_weight_t _weight,
+        const double _font_size, const uint8_t _threshold)
+    : face(std::move(_face)),
+    slant(_slant),
+    weight(_weight),
+    font_size(_font_size),
+    threshold(_threshold) {
+    for(char32_t code_point = FIRST_PRELOADED; code_point <= LAST_PRELOADED; ++code_point)
+        preloaded[code_point - FIRST_PRELOADED] = rasterize(code_point);
+}
+
+GlyphAtlas::Glyph GlyphAtlas::rasterize(const char32_t code_point) const {
+    const std::string text = encode_utf8(code_point);
+
+    /* Measure the glyph */
+    cairo_surface_t *probe = cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+    cairo_t *cr = cairo_create(probe);
+    cairo_select_font_face(cr, face.c_str(), slant, weight);
+    cairo_set_font_size(cr, font_size);
+
+    cairo_text_extents_t ext;
+    cairo_text_extents(cr, text.c_str(), &ext);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(probe);
+
+    Glyph glyph {};
+    glyph.x_bearing = ext.x_bearing;
+    glyph.y_bearing = ext.y_bearing;
+    glyph.width = ext.width;
+    glyph.height = ext.height;
+    glyph.x_advance = ext.x_advance;
+
+    if(ext.width <= 0 || ext.height <= 0)
+        return glyph;  // Whitespace
+
+    /* Draw the glyph with its origin on a whole pixel and a pixel of padding around */
+    const int origin_x = 1 - static_cast<int>(std::floor(ext.x_bearing));
+    const int origin_y = 1 - static_cast<int>(std::floor(ext.y_bearing));
+    const int surface_width = static_cast<int>(std::ceil(ext.width)) + 3;
+    const int surface_height = static_cast<int>(std::ceil(ext.height)) + 3;
+
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_A8, surface_width, surface_height);
+    cr = cairo_create(surface);
+    cairo_select_font_face(cr, face.c_str(), slant, weight);
+    cairo_set_font_size(cr, font_size);
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_move_to(cr, origin_x, origin_y);
+    cairo_show_text(cr, text.c_str());
+    cairo_surface_flush(surface);
+    cairo_destroy(cr);
+
+    const unsigned char *data = cairo_image_surface_get_data(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+
+    // Coverage `a` is black if `255 - a` is lower than the threshold (see `RasterConverter::a8_to_columns()`)
+    const auto ink = [&](const int x, const int y) {
+        return 255 - data[y * stride + x] < threshold;
+    };
+
+    /* Find bounding box of the ink */
+    int min_x = surface_width, min_y = surface_height, max_x = -1, max_y = -1;
+    for(int y = 0; y < surface_height; ++y) {
+        for(int x = 0; x < surface_width; ++x) {
+            if(ink(x, y)) {
+                min_x = std::min(min_x, x);
+                max_x = std::max(max_x, x);
+                min_y = std::min(min_y, y);
+                max_y = std::max(max_y, y);
+            }
+        }
+    }
+
+    if(max_x >= 0) {
+        glyph.left = min_x - origin_x;
+        glyph.top = min_y - origin_y;
+        glyph.columns = static_cast<uint32_t>(max_x - min_x + 1);
+        glyph.rows = static_cast<uint32_t>(max_y - min_y + 1);
+        glyph.column_bytes = (glyph.rows + 7) / 8;
+        glyph.bitmap.assign(glyph.columns * glyph.column_bytes, 0x00);
+
+        for(uint32_t column = 0; column < glyph.columns; ++column) {
+            for(uint32_t row = 0; row < glyph.rows; ++row) {
+                if(ink(min_x + static_cast<int>(column), min_y + static_cast<int>(row)))
+                    glyph.bitmap[column * glyph.column_bytes + row / 8] |= static_cast<uint8_t>(0x80u >> (row % 8));
+            }
+        }
+    }
+
+    cairo_surface_destroy(surface);
+
+    return glyph;
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::get_glyph(const char32_t code_point) {
+    if(code_point >= FIRST_PRELOADED && code_point <= LAST_PRELOADED)
+        return preloaded[code_point - FIRST_PRELOADED];
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& glyph = other_glyphs[code_point];
+    if(!glyph)
+        glyph = std::make_unique<const Glyph>(rasterize(code_point));
+    return *glyph;
+}
+
+cairo_text_extents_t GlyphAtlas::measure(const std::u32string& text) {
+    cairo_text_extents_t ext {};
+
+    double pen = 0;
+    bool has_ink = false;
+    double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+
+    for(const char32_t code_point: text) {
+        const Glyph& glyph = get_glyph(code_point);
+
+        if(glyph.width > 0 && glyph.height > 0) {
+            const double x = pen + glyph.x_bearing;
+            if(!has_ink) {
+                min_x = x;
+                min_y = glyph.y_bearing;
+                max_x = x + glyph.width;
+                max_y = glyph.y_bearing + glyph.height;
+                has_ink = true;
+            }
+            else {
+                min_x = std::min(min_x, x);
+                min_y = std::min(min_y, glyph.y_bearing);
+                max_x = std::max(max_x, x + glyph.width);
+                max_y = std::max(max_y, glyph.y_bearing + glyph.height);
+            }
+        }
+
+        pen += glyph.x_advance;
+    }
+
+    if(has_ink) {
+        ext.x_bearing = min_x;
+        ext.y_bearing = min_y;
+        ext.width = max_x - min_x;
+        ext.height = max_y - min_y;
+    }
+    ext.x_advance = pen;
+
+    return ext;
+}
+
+void GlyphAtlas::draw(const std::u32string& text, const double x, const double y, uint8_t *printing_data,
+        const uint32_t width, const uint32_t height) {
+    const long baseline = std::lround(y);
+    double pen = x;
+
+    for(const char32_t code_point: text) {
+        const Glyph& glyph = get_glyph(code_point);
+        const long glyph_x = std::lround(pen) + glyph.left;
+        const long glyph_y = baseline + glyph.top;
+        pen += glyph.x_advance;
+
+        if(glyph.bitmap.empty())
+            continue;
+
+        const bool inside = glyph_y >= 0 && glyph_y + glyph.rows <= height;
+        const auto shift = static_cast<uint32_t>(glyph_y & 7);
+        const auto first_byte = static_cast<size_t>(glyph_y >> 3);
+
+        for(uint32_t column = 0; column < glyph.columns; ++column) {
+            const long packet = glyph_x + column;
+            if(packet < 0 || packet >= width)
+                continue;
+
+            uint8_t *raster = printing_data + packet * RasterConverter::PACKET_SIZE + RasterConverter::COMMAND_SIZE;
+            const uint8_t *bits = glyph.bitmap.data() + column * glyph.column_bytes;
+
+            if(inside) {
+                // Whole bytes of the glyph column, shifted to the row where the glyph starts
+                for(size_t i = 0; i < glyph.column_bytes; ++i) {
+                    raster[first_byte + i] |= static_cast<uint8_t>(bits[i] >> shift);
+                    if(shift != 0 && first_byte + i + 1 < RasterConverter::RASTER_SIZE)
+                        raster[first_byte + i + 1] |= static_cast<uint8_t>(bits[i] << (8 - shift));
+                }
+            }
+            else {
+                // Glyph crosses top or bottom edge of the label
+                for(uint32_t row = 0; row < glyph.rows; ++row) {
+                    const long label_row = glyph_y + row;
+                    if(label_row < 0 || label_row >= height || !(bits[row / 8] & (0x80u >> (row % 8))))
+                        continue;
+                    raster[label_row / 8] |= static_cast<uint8_t>(0x80u >> (label_row % 8));
+                }
+            }
+        }
+    }
+}
+
+std::u32string GlyphAtlas::decode_utf8(const std::string& text) {
+    constexpr char32_t REPLACEMENT = 0xfffd;
+
+    std::u32string decoded {};
+    decoded.reserve(text.size());
+
+    for(size_t i = 0; i < text.size();) {
+        const auto lead = static_cast<uint8_t>(text[i]);
+
+        size_t length;
+        char32_t code_point;
+        if(lead < 0x80)                { length = 1; code_point = lead; }
+        else if((lead & 0xe0u) == 0xc0) { length = 2; code_point = lead & 0x1fu; }
+        else if((lead & 0xf0u) == 0xe0) { length = 3; code_point = lead & 0x0fu; }
+        else if((lead & 0xf8u) == 0xf0) { length = 4; code_point = lead & 0x07u; }
+        else {
+            decoded += REPLACEMENT;
+            ++i;
+            continue;
+        }
+
+        size_t k = 1;
+        for(; k < length && i + k < text.size(); ++k) {
+            const auto continuation = static_cast<uint8_t>(text[i + k]);
+            if((continuation & 0xc0u) != 0x80)
+                break;
+            code_point = (code_point << 6u) | (continuation & 0x3fu);
+        }
+
+        // Truncated sequence, overlong encoding, surrogate or a code point out of range
+        constexpr char32_t MIN_CODE_POINT[] = {0, 0, 0x80, 0x800, 0x10000};
+        if(k != length || code_point < MIN_CODE_POINT[length] || code_point > 0x10ffff
+                || (code_point >= 0xd800 && code_point <= 0xdfff)) {
+            decoded += REPLACEMENT;
+            i += k;
+            continue;
+        }
+
+        decoded += code_point;
+        i += length;
+    }
+
+    return decoded;
+}
+
+std::shared_ptr<GlyphAtlas> GlyphAtlasCache::get(const std::string& face, const cairo_font_slant_t slant,
+        const cairo_font_weight_t weight, const double font_size, const uint8_t threshold) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& atlas = atlases[{face, slant, weight, font_size, threshold}];
+    if(!atlas)
+        atlas = std::make_shared<GlyphAtlas>(face, slant, weight, font_size, threshold);
+    return atlas;
+}
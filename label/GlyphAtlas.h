@@ -0,0 +1,136 @@
+#ifndef LABEL_PRINTER_DRIVER_GLYPHATLAS_H
+#define LABEL_PRINTER_DRIVER_GLYPHATLAS_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <cairo/cairo.h>
+
+/**
+ * Engines which can draw text of product labels.
+ *
+ * @see ProductLabelCreator::set_text_engine(TextEngine)
+ */
+enum class TextEngine {
+    CAIRO,  /**< Text is drawn by cairo into a surface, which is then converted into printing data */
+    GLYPH_ATLAS  /**< Text is blitted straight into printing data from 1-bit glyphs (see `GlyphAtlas`) */
+};
+
+/**
+ * 1-bit glyphs of a single font at a single size.
+ *
+ * Every glyph is rasterized only once (with cairo, antialiased and thresholded like label
+ * surfaces) and stored column by column in the same bit order as printing data, so text can
+ * be drawn by OR-ing glyph columns into column packets without any further conversion.
+ *
+ * Printable ASCII is rasterized up front and can be read without locking; other characters
+ * are rasterized on first use.
+ *
+ * @see RasterConverter
+ */
+class GlyphAtlas {
+public:
+    /**
+     * Glyph metrics (the same as `cairo_text_extents_t` of the glyph) and its bitmap.
+     */
+    struct Glyph {
+        double x_bearing {};
+        double y_bearing {};
+        double width {};
+        double height {};
+        double x_advance {};
+
+        int left {};  /**< Offset of the bitmap from the glyph origin in pixels */
+        int top {};
+        uint32_t columns {};  /**< Width of the bitmap */
+        uint32_t rows {};  /**< Height of the bitmap */
+        uint32_t column_bytes {};  /**< Bytes per bitmap column, first row is the MSB of the first byte */
+        std::vector<uint8_t> bitmap;
+    };
+
+private:
+    static constexpr char32_t FIRST_PRELOADED = 0x20;
+    static constexpr char32_t LAST_PRELOADED = 0x7e;
+
+    std::string face;
+    cairo_font_slant_t slant;
+    cairo_font_weight_t weight;
+    double font_size;
+    uint8_t threshold;
+
+    std::array<Glyph, LAST_PRELOADED - FIRST_PRELOADED + 1> preloaded {};
+    std::unordered_map<char32_t, std::unique_ptr<const Glyph>> other_glyphs;
+    std::mutex mutex;
+
+    [[nodiscard]] Glyph rasterize(char32_t code_point) const;
+
+public:
+    /**
+     * @param face Font family
+     * @param slant Font slant
+     * @param weight Font weight
+     * @param font_size Font size in pixels (points of the label)
+     * @param threshold Black/white threshold (see `Label::set_threshold(uint8_t)`)
+     */
+    GlyphAtlas(std::string face, cairo_font_slant_t slant, cairo_font_weight_t weight, double font_size,
+            uint8_t threshold);
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    /**
+     * @return Glyph of the character, which stays valid as long as the atlas
+     */
+    [[nodiscard]] const Glyph& get_glyph(char32_t code_point);
+
+    /**
+     * Measures text the same way as `cairo_text_extents()`.
+     */
+    [[nodiscard]] cairo_text_extents_t measure(const std::u32string& text);
+
+    /**
+     * ORs the text into printing data.
+     *
+     * @param text Text to draw
+     * @param x Horizontal position of the text origin
+     * @param y Vertical position of the text baseline
+     * @param printing_data Column packets as returned by `Label::get_printing_data()`
+     * @param width Number of columns (packets) of `printing_data`
+     * @param height Height of the label, rows below it are left blank
+     */
+    void draw(const std::u32string& text, double x, double y, uint8_t *printing_data, uint32_t width, uint32_t height);
+
+    /**
+     * Decodes UTF-8 text. Invalid sequences are replaced with U+FFFD.
+     */
+    [[nodiscard]] static std::u32string decode_utf8(const std::string& text);
+};
+
+/**
+ * Glyph atlases of fonts and sizes used by one config.
+ */
+class GlyphAtlasCache {
+private:
+    using Key = std::tuple<std::string, cairo_font_slant_t, cairo_font_weight_t, double, uint8_t>;
+
+    std::map<Key, std::shared_ptr<GlyphAtlas>> atlases;
+    std::mutex mutex;
+
+public:
+    /**
+     * @return Atlas of given font, size and threshold - created if it doesn't exist yet
+     *
+     * @see GlyphAtlas(std::string, cairo_font_slant_t, cairo_font_weight_t, double, uint8_t)
+     */
+    [[nodiscard]] std::shared_ptr<GlyphAtlas> get(const std::string& face, cairo_font_slant_t slant,
+            cairo_font_weight_t weight, double font_size, uint8_t threshold);
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_GLYPHATLAS_H
@@ -2,46 +2,111 @@
 
 #include "Label.h"
 
-LabelType Label::type = LabelType::UNDEFINED;
-LabelDimensions Label::dimensions = {};
+LabelFormat Label::default_format {};
 
-Label::Label() {
-    if(!is_valid())
-        throw std::runtime_error("Label type not set! Use provided static function to set it");
-}
-
-void Label::set_die_cut_label_type(LabelSubtypes::DieCut _label_type) {
-    const auto& lab_it = LabelSubtypes::__die_cut_dimensions.find(_label_type);
+LabelFormat LabelFormat::die_cut(const LabelSubtypes::DieCut label_type) {
+    const auto& lab_it = LabelSubtypes::__die_cut_dimensions.find(label_type);
     if(lab_it == LabelSubtypes::__die_cut_dimensions.end())
         throw std::runtime_error("This label type is not supported");
 
-    Label::type = LabelType::DIE_CUT;
-    Label::dimensions = lab_it->second;
+    return {LabelType::DIE_CUT, lab_it->second};
 }
 
-void Label::set_continuous_length_label_type(LabelSubtypes::ContinuousLength _label_type, const int width_mm) {
-    const auto& lab_it = LabelSubtypes::__continuous_length_dimensions.find(_label_type);
+LabelFormat LabelFormat::continuous_length(const LabelSubtypes::ContinuousLength label_type, const int width_mm) {
+    const auto& lab_it = LabelSubtypes::__continuous_length_dimensions.find(label_type);
     if(lab_it == LabelSubtypes::__continuous_length_dimensions.end())
         throw std::runtime_error("This label type is not supported");
 
-    if(Label::dimensions.width_pt < 13 || Label::dimensions.width_pt > 1000)
+    if(width_mm < 13 || width_mm > 1000)
         throw std::invalid_argument("Label width must be in range <13mm, 1000mm>");
 
-    Label::type = LabelType::CONTINUOUS_LENGTH;
-    Label::dimensions.width_mm = width_mm;
-    Label::dimensions.height_mm = lab_it->second.height_mm;
-    Label::dimensions.width_pt = static_cast<uint32_t>(round(width_mm * 0.03937 * 300));
-    Label::dimensions.height_pt = lab_it->second.height_pt;
+    LabelFormat format {LabelType::CONTINUOUS_LENGTH, lab_it->second};
+    format.dimensions.width_mm = width_mm;
+    format.dimensions.width_pt = static_cast<uint32_t>(round(width_mm * 0.03937 * 300));
+
+    return format;
+}
+
+bool LabelFormat::is_valid() const noexcept {
+    return type != LabelType::UNDEFINED;
+}
+
+bool LabelFormat::operator==(const LabelFormat& other) const noexcept {
+    return type == other.type
+        && dimensions.width_mm == other.dimensions.width_mm
+        && dimensions.height_mm == other.dimensions.height_mm
+        && dimensions.width_pt == other.dimensions.width_pt
+        && dimensions.height_pt == other.dimensions.height_pt;
+}
+
+bool LabelFormat::operator!=(const LabelFormat& other) const noexcept {
+    return !(*this == other);
+}
+
+Label::Label() : Label(default_format) {}
+
+Label::Label(const LabelFormat& _format) {
+    set_format(_format);
+}
+
+void Label::set_die_cut_label_type(LabelSubtypes::DieCut _label_type) {
+    Label::default_format = LabelFormat::die_cut(_label_type);
+}
+
+void Label::set_continuous_length_label_type(LabelSubtypes::ContinuousLength _label_type, const int width_mm) {
+    Label::default_format = LabelFormat::continuous_length(_label_type, width_mm);
+}
+
+void Label::set_default_format(const LabelFormat& _format) noexcept {
+    default_format = _format;
+}
+
+LabelFormat Label::get_default_format() {
+    return default_format;
 }
 
 LabelType Label::get_type() {
-    return type;
+    return default_format.type;
 }
 
 LabelDimensions Label::get_dimensions() {
-    return dimensions;
+    return default_format.dimensions;
 }
 
 bool Label::is_valid() {
-    return type != LabelType::UNDEFINED;
+    return default_format.is_valid();
+}
+
+void Label::set_format(const LabelFormat& _format) {
+    if(!_format.is_valid())
+        throw std::runtime_error("Label type not set! Use provided static function to set it");
+    format = _format;
+}
+
+const LabelFormat& Label::get_format() const noexcept {
+    return format;
+}
+
+void Label::set_threshold(const uint8_t _threshold) noexcept {
+    threshold = _threshold;
+}
+
+uint8_t Label::get_threshold() const noexcept {
+    return threshold;
+}
+
+std::unique_ptr<RenderedLabel> Label::render() const {
+    return nullptr;
+}
+
+std::vector<uint8_t> Label::rasterize(const RenderedLabel*) const {
+    return get_printing_data();
+}
+
+void Label::rasterize(const RenderedLabel *rendered, std::vector<uint8_t>& printing_data) const {
+    printing_data = rasterize(rendered);
+}
+
+std::unique_ptr<LabelStrips> Label::render_strips() const {
+    return nullptr;
 }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 
 /**
@@ -68,6 +69,76 @@ namespace LabelSubtypes {
     };
 }
 
+/**
+ * Media format - label type together with label dimensions.
+ *
+ * Each label and each print job carries its own format, so labels for different
+ * media can be rendered and printed at the same time.
+ */
+struct LabelFormat {
+    LabelType type = LabelType::UNDEFINED;
+    LabelDimensions dimensions {};
+
+    /**
+     * @param label_type Specific `DieCut` label type
+     * @return Format of die-cut labels
+     *
+     * @throws std::runtime_error if `label_type` is not supported
+     * @see LabelSubtypes::DieCut
+     */
+    [[nodiscard]] static LabelFormat die_cut(LabelSubtypes::DieCut label_type);
+
+    /**
+     * @param label_type Specific `ContinuousLength` label type
+     * @param width_mm Desired width of the label in millimeters
+     * @return Format of continuous length labels
+     *
+     * @throws std::runtime_error if `label_type` is not supported
+     * @throws std::invalid_argument if label width is not in allowed range
+     * @see LabelSubtypes::ContinuousLength
+     */
+    [[nodiscard]] static LabelFormat continuous_length(LabelSubtypes::ContinuousLength label_type, int width_mm);
+
+    /**
+     * @return `true` if `type` is not `LabelType::UNDEFINED`
+     */
+    [[nodiscard]] bool is_valid() const noexcept;
+
+    bool operator==(const LabelFormat& other) const noexcept;
+    bool operator!=(const LabelFormat& other) const noexcept;
+};
+
+/**
+ * Intermediate result of label rendering (for example an image) which
+ * is turned into printing data by `Label::rasterize(const RenderedLabel*)`.
+ */
+class RenderedLabel {
+public:
+    virtual ~RenderedLabel() = default;
+};
+
+/**
+ * Label which is rendered and rasterized strip by strip (see `Label::render_strips()`).
+ *
+ * Each column of the label is a separate packet, so printing data of consecutive strips
+ * put one after another is the printing data of the whole label.
+ */
+class LabelStrips {
+public:
+    virtual ~LabelStrips() = default;
+
+    /**
+     * Renders and rasterizes `columns` columns of the label starting with `first_column`.
+     *
+     * @param first_column Index of the first column of the strip
+     * @param columns Number of columns of the strip
+     * @param printing_data Output buffer, its contents are replaced with `columns` packets
+     *
+     * @throws std::invalid_argument if the strip is empty or it doesn't lie within the label
+     */
+    virtual void rasterize(uint32_t first_column, uint32_t columns, std::vector<uint8_t>& printing_data) = 0;
+};
+
 /**
  * Base class for label representation.
  *
@@ -76,21 +147,33 @@ namespace LabelSubtypes {
  */
 class Label {
 protected:
-    static LabelType type;
-    static LabelDimensions dimensions;
+    static LabelFormat default_format;
+
+    LabelFormat format;
+    uint8_t threshold = DEFAULT_THRESHOLD;
 
 public:
+    static constexpr uint8_t DEFAULT_THRESHOLD = 190;
+
     /**
-     * Default constructor that checks if `type` is set (is not `LabelType::UNDEFINED`.
+     * Default constructor that uses the default format (see `set_die_cut_label_type(LabelSubtypes::DieCut)`
+     * and `set_continuous_length_label_type(LabelSubtypes::ContinuousLength, int)`).
      *
-     * @throws std::runtime_exception if `type` is set to `LabelType::UNDEFINED`
+     * @throws std::runtime_exception if the default format is not set
      * @see LabelType
      */
     Label();
+
+    /**
+     * @param format Media format of the label
+     *
+     * @throws std::runtime_exception if `format` is not valid
+     */
+    explicit Label(const LabelFormat& format);
     virtual ~Label() = default;
 
     /**
-     * Sets `type = LabelType:DIE_CUT`
+     * Sets default format to `LabelFormat::die_cut(label_type)`
      *
      * @param label_type Specific `DieCut` label type
      *
@@ -100,7 +183,7 @@ public:
     static void set_die_cut_label_type(LabelSubtypes::DieCut label_type);
 
     /**
-     * Sets `type = LabelType::CONTINUOUS_LENGTH`
+     * Sets default format to `LabelFormat::continuous_length(label_type, width_mm)`
      *
      * @param label_type Specific `ContinuousLength` label type
      * @param width_mm Desired width of the label in millimeters
@@ -111,25 +194,89 @@ public:
      */
     static void set_continuous_length_label_type(LabelSubtypes::ContinuousLength label_type, int width_mm);
 
+    /**
+     * Default format is used by labels and print jobs which are created without explicit format.
+     */
+    static void set_default_format(const LabelFormat& format) noexcept;
+    static LabelFormat get_default_format();
+
     static LabelType get_type();
     static LabelDimensions get_dimensions();
 
     /**
-     * @return `true` if `type` is not `LabelType::UNDEFINED`
+     * @return `true` if the default format is set
      */
     static bool is_valid();
 
+    /**
+     * @throws std::runtime_exception if `format` is not valid
+     */
+    void set_format(const LabelFormat& format);
+    [[nodiscard]] const LabelFormat& get_format() const noexcept;
+
+    /**
+     * Sets black/white threshold used when the label image is converted to printing data.
+     * Pixels with luma lower than `threshold` are printed (black).
+     *
+     * @param threshold Black/white threshold, `DEFAULT_THRESHOLD` by default
+     */
+    void set_threshold(uint8_t threshold) noexcept;
+    [[nodiscard]] uint8_t get_threshold() const noexcept;
+
     /**
      * Construct and return printing data packet.
      *
      * The printing data packet consists of *n* 93 bytes sub-packets where
      * the first 3 bytes is a print data command and the rest is raster data
-     * composed of `1` or `0` values for each pixel. *n* is equal to `dimensions.width_pt`.
+     * composed of `1` or `0` values for each pixel. *n* is equal to `format.dimensions.width_pt`.
      * Each sub-packet contains raster data of one column of the label image.
      *
      * @return printing data packet as `std::vector` of bytes
      */
     [[nodiscard]] virtual std::vector<uint8_t> get_printing_data() const = 0;
+
+    /**
+     * First stage of `get_printing_data()`, which renders the label.
+     *
+     * Together with `rasterize(const RenderedLabel*)` it allows rendering and
+     * rasterizing of different labels to run at the same time (see `PrintPipeline`).
+     * Default implementation does nothing and leaves all of the work to `rasterize()`.
+     *
+     * @return Rendered label or `nullptr`
+     */
+    [[nodiscard]] virtual std::unique_ptr<RenderedLabel> render() const;
+
+    /**
+     * Second stage of `get_printing_data()`, which turns result of `render()` into printing data.
+     *
+     * Default implementation ignores `rendered` and returns `get_printing_data()`.
+     *
+     * @param rendered Result of `render()` called on the same label
+     * @return printing data packet as `std::vector` of bytes
+     */
+    [[nodiscard]] virtual std::vector<uint8_t> rasterize(const RenderedLabel *rendered) const;
+
+    /**
+     * Same as above, but writes printing data into `printing_data`, so a buffer that
+     * already has enough capacity can be reused.
+     *
+     * Default implementation assigns result of `rasterize(const RenderedLabel*)`.
+     *
+     * @param rendered Result of `render()` called on the same label
+     * @param printing_data Output buffer, its contents are replaced
+     */
+    virtual void rasterize(const RenderedLabel *rendered, std::vector<uint8_t>& printing_data) const;
+
+    /**
+     * Prepares the label to be rendered and rasterized in strips of columns, so that only
+     * a strip of the image has to be in memory at once (see `Printer::print_streaming()`).
+     * The label must outlive the returned object.
+     *
+     * Default implementation returns `nullptr`, which means the label can be rendered only as a whole.
+     *
+     * @return Strips of the label or `nullptr`
+     */
+    [[nodiscard]] virtual std::unique_ptr<LabelStrips> render_strips() const;
 };
 
 
@@ -0,0 +1,39 @@
+#ifndef LABEL_PRINTER_DRIVER_LABELSOURCE_H
+#define LABEL_PRINTER_DRIVER_LABELSOURCE_H
+
+#include <functional>
+#include <memory>
+
+#include "Label.h"
+
+/**
+ * Pull-based source of labels: each call returns the next label, or `nullptr` once there are no more.
+ *
+ * Labels are pulled one at a time while the job is being printed (never more than the labels in flight
+ * of `PrintPipeline`) and released once they are rasterized. So a source which creates its labels
+ * (for example a generator going through a whole catalog) prints in constant memory, and the first
+ * label is printed before the source runs out. The source is called from one thread at a time.
+ *
+ * Labels which outlive the job can be returned without ownership (see `make_label_source()`).
+ */
+using LabelSource = std::function<std::shared_ptr<const Label>()>;
+
+/**
+ * @param first Iterator to the first label pointer (raw or smart), the range must outlive the job
+ * @param last Iterator past the last label pointer
+ * @return Source of labels of the range, which doesn't take ownership of them
+ */
+template<typename Iterator>
+[[nodiscard]] LabelSource make_label_source(Iterator first, const Iterator last) {
+    return [first, last]() mutable -> std::shared_ptr<const Label> {
+        if(first == last)
+            return nullptr;
+
+        // Aliasing constructor - the pointer isn't owned and nothing is allocated
+        const Label *label = &**first++;
+        return std::shared_ptr<const Label>(std::shared_ptr<const Label>(), label);
+    };
+}
+
+
+#endif //LABEL_PRINTER_DRIVER_LABELSOURCE_H
@@ -1,15 +1,72 @@
+#include <type_traits>
+
 #include "ProductLabel.h"
 #include "ProductLabelCreator.h"
+#include "RasterConverter.h"
+#include "RasterCache.h"
+#include "../utils/ObjectPool.h"
+#include "../utils/Tracer.h"
+
+namespace {
+    /* Strings of released keys keep their memory, so filling a key in doesn't allocate */
+    ObjectPool<RasterCacheKey> cache_keys {};
+
+    template<typename T>
+    using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+    /**
+     * @return Pool of memory for objects of type `T`
+     */
+    template<typename T>
+    ObjectPool<Storage<T>>& storage_pool() {
+        static ObjectPool<Storage<T>> pool {};
+        return pool;
+    }
+}
+
+/**
+ * Strips of a product label rendered with one creator and one set of dates.
+ */
+class ProductLabel::Strips : public LabelStrips {
+private:
+    const ProductLabel& label;
+    const ProductLabelCreator creator;
+    const ProductLabelDates dates;
+
+public:
+    Strips(const ProductLabel& _label, ProductLabelCreator _creator)
+        : label(_label),
+        creator(std::move(_creator)),
+        dates(creator.format_dates(label)) {}
+
+    void rasterize(const uint32_t first_column, const uint32_t columns, std::vector<uint8_t>& printing_data) override {
+        cairo_surface_t *surface = creator.render_strip(label, dates, first_column, columns);
+
+        LabelDimensions dimensions = label.format.dimensions;
+        dimensions.width_pt = columns;
+
+        try {
+            prepare_for_printing(surface, dimensions, label.threshold, printing_data);
+        }
+        catch(...) {
+            cairo_surface_destroy(surface);
+            throw;
+        }
+        cairo_surface_destroy(surface);
+    }
+};
 
 ProductLabel::ProductLabel(std::string _name, ProductUsage _usage, std::optional<std::time_t> start,
-        std::optional<std::string> ready, std::string discard) noexcept
-    : name(std::move(_name)),
+        std::optional<std::string> ready, std::string discard, const LabelFormat& _format)
+    : Label(_format),
+    name(std::move(_name)),
     usage(_usage),
     start_date(start),
     ready_date(std::move(ready)),
     discard_date(std::move(discard)) {}
 
-ProductLabel::ProductLabel(const YAML::Node& node, const ProductUsage _usage) {
+ProductLabel::ProductLabel(const YAML::Node& node, const ProductUsage _usage, const LabelFormat& _format)
+    : Label(_format) {
     usage = _usage;
     std::string usage_str {};
     switch(usage){
@@ -39,70 +96,164 @@ void ProductLabel::set_start_date(std::optional<std::time_t> start) noexcept {
     start_date = start;
 }
 
+const std::string& ProductLabel::get_name() const noexcept {
+    return name;
+}
+
+ProductUsage ProductLabel::get_usage() const noexcept {
+    return usage;
+}
+
 std::vector<uint8_t> ProductLabel::prepare_for_printing(cairo_surface_t *surface) const {
+    return prepare_for_printing(surface, format.dimensions, threshold);
+}
+
+std::vector<uint8_t> ProductLabel::prepare_for_printing(cairo_surface_t *surface, const LabelDimensions& dimensions,
+        const uint8_t threshold) {
     std::vector<uint8_t> printing_data {};
+    prepare_for_printing(surface, dimensions, threshold, printing_data);
+    return printing_data;
+}
+
+void ProductLabel::prepare_for_printing(cairo_surface_t *surface, const LabelDimensions& dimensions,
+        const uint8_t threshold, std::vector<uint8_t>& printing_data) {
+    TraceSpan span("raster_conversion", "raster");
+    span.set_arg("columns", dimensions.width_pt);
+
     /*
     Each packet consist of 3 bytes of print data command and 90 bytes of pixel data.
     For each column of the label we need a separate packet.
     */
-    printing_data.reserve(Label::dimensions.width_pt * 93);
+    printing_data.resize(dimensions.width_pt * RasterConverter::PACKET_SIZE);
 
     const unsigned char *label_data = cairo_image_surface_get_data(surface);
-    if(cairo_image_surface_get_format(surface) != CAIRO_FORMAT_RGB24)
-        throw std::invalid_argument("Wrong label surface format - should be RGB24");
-
     const int stride = cairo_image_surface_get_stride(surface);  // Number of bytes per label row
-    const bool unaligned_pixels = Label::dimensions.height_pt % 8 != 0;
-    const auto fill_amount = static_cast<size_t>(90 - std::ceil(Label::dimensions.height_pt / 8.0));  // Amount of zero-padding for each column
-
-    uint8_t pixel_octet = 0;    // Store subsequent pixel values
-    uint8_t pixels_packed = 7;  // Tell how many pixels are remaining in order to fill pixel_octet
-
-    for(unsigned i = 0, offset = 0; i < Label::dimensions.width_pt; ++i, offset += 4) {
-        // Add print data command to the beginning of the next packet
-        printing_data.insert(printing_data.end(), {0x67, 0x00, 0x5a});
-
-        for(unsigned k = 0; k < Label::dimensions.height_pt; ++k) {
-            const bool pixel = thresh(label_data + (k * stride + offset));
-            pixel_octet |= static_cast<uint8_t>(pixel << pixels_packed);  // Set pixel value
-
-            // If all bits of the pixel octet are initialized, add it to the packet
-            if(pixels_packed == 0) {
-                printing_data.push_back(pixel_octet);
-                pixel_octet = 0;
-                pixels_packed = 7;
-            }
-            else
-                --pixels_packed;
-        }
 
-        // If label height is not divisible by 8, add an uncompleted pixel to the packet
-        if(unaligned_pixels) {
-            printing_data.push_back(pixel_octet);
-            pixel_octet = 0;
-            pixels_packed = 7;
-        }
-
-        // Fill the rest of the packet with zeros
-        printing_data.insert(printing_data.end(), fill_amount, 0x00);
+    switch(cairo_image_surface_get_format(surface)) {
+        case CAIRO_FORMAT_RGB24:
+            RasterConverter::rgb24_to_columns(label_data, stride, dimensions.width_pt, dimensions.height_pt,
+                    printing_data.data(), threshold);
+            break;
+        case CAIRO_FORMAT_A8:
+            RasterConverter::a8_to_columns(label_data, stride, dimensions.width_pt, dimensions.height_pt,
+                    printing_data.data(), threshold);
+            break;
+        case CAIRO_FORMAT_A1:
+            RasterConverter::a1_to_columns(label_data, stride, dimensions.width_pt, dimensions.height_pt,
+                    printing_data.data());
+            break;
+        default:
+            throw std::invalid_argument("Wrong label surface format - should be RGB24, A8 or A1");
     }
+}
 
-    return printing_data;
+std::vector<uint8_t> ProductLabel::get_printing_data() const {
+    const std::unique_ptr<RenderedLabel> rendered = render();
+    return rasterize(rendered.get());
 }
 
-inline bool ProductLabel::thresh(const unsigned char *pix, int threshold) noexcept {
-    return (pix[0] * 0.299 + pix[1] * 0.587 + pix[2] * 0.114) < threshold;
+ProductLabel::RenderedSurface::~RenderedSurface() {
+    if(surface != nullptr)
+        cairo_surface_destroy(surface);
+    cache_keys.release(std::unique_ptr<RasterCacheKey>(key));
 }
 
-std::vector<uint8_t> ProductLabel::get_printing_data() const {
-    cairo_surface_t *label_surface = ProductLabelCreator::create_label_surface(*this);
-    std::vector<uint8_t> printing_data = prepare_for_printing(label_surface);
-    cairo_surface_destroy(label_surface);
+void *ProductLabel::RenderedSurface::operator new(const size_t size) {
+    if(size != sizeof(RenderedSurface))
+        return ::operator new(size);
+    return storage_pool<RenderedSurface>().acquire().release();
+}
+
+void ProductLabel::RenderedSurface::operator delete(void *memory, const size_t size) noexcept {
+    if(size != sizeof(RenderedSurface)) {
+        ::operator delete(memory);
+        return;
+    }
+    storage_pool<RenderedSurface>().release(
+            std::unique_ptr<Storage<RenderedSurface>>(static_cast<Storage<RenderedSurface>*>(memory)));
+}
+
+std::unique_ptr<RenderedLabel> ProductLabel::render() const {
+    RasterCache& cache = ProductLabelCreator::get_raster_cache();
+    auto rendered = std::make_unique<RenderedSurface>();
 
+    // Read before the config, so data rendered with a config replaced in the meantime is not cached
+    rendered->cache_generation = cache.get_generation();
+
+    const ProductLabelCreator creator = ProductLabelCreator::get_default();
+
+    // Strings of both keep their memory from label to label
+    thread_local ProductLabelDates dates {};
+    creator.format_dates(*this, dates);
+
+    rendered->key = cache_keys.acquire().release();
+    RasterCacheKey& key = *rendered->key;
+    key.name = name;
+    key.usage = usage;
+    key.format = format;
+    key.start_date = dates.start;
+    if(dates.ready)
+        key.ready_date = dates.ready.value();
+    else
+        key.ready_date.clear();
+    key.discard_date = dates.discard;
+    key.threshold = threshold;
+    key.surface_format = creator.get_output_format();
+    key.text_engine = creator.get_engine();
+
+    rendered->cached = cache.find(key);
+    if(!rendered->cached) {
+        rendered->static_layer = creator.get_static_layer(format, ready_date.has_value(), threshold);
+        if(creator.get_engine() == TextEngine::GLYPH_ATLAS)
+            rendered->printing_data = creator.render_printing_data(*this, dates, *rendered->static_layer, threshold);
+        else
+            rendered->surface = creator.render_dynamic(*this, dates, *rendered->static_layer);
+    }
+
+    return rendered;
+}
+
+std::vector<uint8_t> ProductLabel::rasterize(const RenderedLabel *rendered) const {
+    std::vector<uint8_t> printing_data {};
+    rasterize(rendered, printing_data);
     return printing_data;
 }
 
-std::vector<std::shared_ptr<Label>> ProductLabel::load_label_definitions(const std::string &def_file) {
+void ProductLabel::rasterize(const RenderedLabel *rendered, std::vector<uint8_t>& printing_data) const {
+    const auto *rendered_surface = dynamic_cast<const RenderedSurface*>(rendered);
+    if(rendered_surface == nullptr)
+        throw std::invalid_argument("Product label can be rasterized only from its own rendered surface");
+
+    if(rendered_surface->cached) {
+        printing_data.assign(rendered_surface->cached->begin(), rendered_surface->cached->end());
+        return;
+    }
+
+    if(rendered_surface->printing_data) {
+        const std::vector<uint8_t>& drawn = rendered_surface->printing_data.value();
+        printing_data.assign(drawn.begin(), drawn.end());
+    }
+    else
+        prepare_for_printing(rendered_surface->surface, format.dimensions, threshold, printing_data);
+
+    // Command bytes of both are the same, so the whole packets can be merged
+    if(rendered_surface->surface != nullptr && rendered_surface->static_layer) {
+        const std::vector<uint8_t>& static_data = rendered_surface->static_layer->printing_data;
+        for(size_t i = 0; i < printing_data.size(); ++i)
+            printing_data[i] |= static_data[i];
+    }
+
+    if(rendered_surface->key != nullptr) {
+        ProductLabelCreator::get_raster_cache().insert(*rendered_surface->key, printing_data,
+                rendered_surface->cache_generation);
+    }
+}
+
+std::unique_ptr<LabelStrips> ProductLabel::render_strips() const {
+    return std::make_unique<Strips>(*this, ProductLabelCreator::get_default());
+}
+
+std::vector<std::shared_ptr<Label>> ProductLabel::load_label_definitions(const std::string &def_file, const LabelFormat& format) {
     const YAML::Node root = YAML::LoadFile(def_file);
     if(!root["products"])
         throw std::runtime_error("No 'products' key found in label definition file: " + def_file);
@@ -114,11 +265,11 @@ std::vector<std::shared_ptr<Label>> ProductLabel::load_label_definitions(const s
     std::vector<std::shared_ptr<Label>> labels {};
     for(const auto& i: products) {
         if(i["board"])
-            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::BOARD)));
+            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::BOARD, format)));
         if(i["prep"])
-            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::PREP)));
+            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::PREP, format)));
         if(i["storage"])
-            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::STORAGE)));
+            labels.push_back(std::make_shared<ProductLabel>(ProductLabel(i, ProductUsage::STORAGE, format)));
     }
 
     return labels;
@@ -13,6 +13,9 @@ enum class ProductUsage {
     STORAGE
 };
 
+struct RasterCacheKey;
+struct StaticLayer;
+
 /**
  * Label subclass that represents a product label which has information
  * about:
@@ -25,6 +28,36 @@ enum class ProductUsage {
  */
 class ProductLabel : public Label {
 private:
+    /**
+     * One of:
+     * - dynamic part of the label (see `ProductLabelCreator::render_dynamic()`) together with its static layer,
+     * - printing data drawn with `TextEngine::GLYPH_ATLAS`,
+     * - printing data of the same label found in the raster cache.
+     *
+     * Surface is destroyed together with this object.
+     */
+    struct RenderedSurface : public RenderedLabel {
+        cairo_surface_t *surface = nullptr;
+        std::shared_ptr<const StaticLayer> static_layer;
+        std::optional<std::vector<uint8_t>> printing_data;
+        std::shared_ptr<const std::vector<uint8_t>> cached;
+
+        RasterCacheKey *key = nullptr;  /**< Key under which rasterized `surface` is cached, owned (from a pool) */
+        uint64_t cache_generation = 0;
+
+        RenderedSurface() noexcept = default;
+        ~RenderedSurface() override;
+
+        RenderedSurface(const RenderedSurface&) = delete;
+        RenderedSurface& operator=(const RenderedSurface&) = delete;
+
+        /* Memory of rendered surfaces is pooled, so that rendering of a label doesn't allocate */
+        static void *operator new(size_t size);
+        static void operator delete(void *memory, size_t size) noexcept;
+    };
+
+    class Strips;
+
     std::string name;
     ProductUsage usage;
     std::optional<std::time_t> start_date;
@@ -35,30 +68,38 @@ private:
      * Takes `cairo_surface_t` and converts it to vector of bytes which
      * represents printing data.
      *
-     * @param surface Image in RGB24 format that represents a product label
+     * @param surface Image in RGB24, A8 or A1 format that represents a product label
      * @return printing data
      *
-     * @throws std::invalid_argument if image is not in RGB24 format
+     * @throws std::invalid_argument if image is not in one of supported formats
      *
-     * @see get_printing_data()
+     * @see get_printing_data(), RasterConverter
      */
     [[nodiscard]] std::vector<uint8_t> prepare_for_printing(cairo_surface_t *surface) const;
 
     /**
-     * Little helper function for converting single RGB24 pixel into a boolean value.
-     *
-     * First it converts the pixel to grayscale and then uses `threshold` to determine
-     * if treat it as a black or white.
-     *
-     * @param pix A pointer to RGB24 pixel
+     * @param surface Image in RGB24, A8 or A1 format
+     * @param dimensions Dimensions of the image
      * @param threshold Black/white threshold
-     * @return Pixel converted to a boolean value
+     *
+     * @see prepare_for_printing(cairo_surface_t*)
+     */
+    [[nodiscard]] static std::vector<uint8_t> prepare_for_printing(cairo_surface_t *surface,
+            const LabelDimensions& dimensions, uint8_t threshold);
+
+    /**
+     * Same as above, but writes printing data into (resized) `printing_data`.
      */
-    [[nodiscard]] static inline bool thresh(const unsigned char *pix, int threshold = 190) noexcept;
+    static void prepare_for_printing(cairo_surface_t *surface, const LabelDimensions& dimensions, uint8_t threshold,
+            std::vector<uint8_t>& printing_data);
 
 public:
+    /**
+     * @throws std::runtime_error if `format` is not valid
+     */
     ProductLabel(std::string name, ProductUsage usage, std::optional<std::time_t> start,
-            std::optional<std::string> ready, std::string discard) noexcept;
+            std::optional<std::string> ready, std::string discard,
+            const LabelFormat& format = Label::get_default_format());
 
     /**
      * Constructs `ProductLabel` from a YAML node.
@@ -70,11 +111,12 @@ public:
      *
      * @param node YAML node which contains required keys to construct a `ProductLabel`
      * @param usage Label usage
+     * @param format Media format of the label
      *
      * @throws std::invalid_argument if `usage` is not supported
-     * @throws std::runtime_error if the `node` doesn't have required keywords
+     * @throws std::runtime_error if the `node` doesn't have required keywords or `format` is not valid
      */
-    ProductLabel(const YAML::Node& node, ProductUsage usage);
+    ProductLabel(const YAML::Node& node, ProductUsage usage, const LabelFormat& format = Label::get_default_format());
 
     ~ProductLabel() override = default;
 
@@ -87,15 +129,20 @@ public:
      * only when the program starts or the contents of config file changes.
      *
      * @param def_file Config file (in YAML format) which stores the definitions
+     * @param format Media format of loaded labels
      * @return A vector of pointers to loaded labels
      *
      * @throws std::runtime_error if the file doesn't have a *products* key or the *products* key
      * is not a sequence
      */
-    [[nodiscard]] static std::vector<std::shared_ptr<Label>> load_label_definitions(const std::string& def_file);
+    [[nodiscard]] static std::vector<std::shared_ptr<Label>> load_label_definitions(const std::string& def_file,
+            const LabelFormat& format = Label::get_default_format());
 
     void set_start_date(std::optional<std::time_t> start) noexcept;
 
+    [[nodiscard]] const std::string& get_name() const noexcept;
+    [[nodiscard]] ProductUsage get_usage() const noexcept;
+
     /**
      * Uses `ProductLabelCreator::create_label_surface(ProductLabel&)` to
      * obtain printing data for the label.
@@ -107,7 +154,35 @@ public:
      */
     [[nodiscard]] std::vector<uint8_t> get_printing_data() const override;
 
+    /**
+     * Renders product name and dates of the label with the default `ProductLabelCreator`, unless
+     * printing data of the same label (with the same formatted dates) is in `ProductLabelCreator::get_raster_cache()`.
+     * Guides and date captions are taken from the already rasterized static layer.
+     */
+    [[nodiscard]] std::unique_ptr<RenderedLabel> render() const override;
+
+    /**
+     * Converts rendered label surface to printing data, merges it with the static layer
+     * and stores it in the raster cache.
+     *
+     * @throws std::invalid_argument if `rendered` wasn't returned from `ProductLabel::render()`
+     *
+     * @see prepare_for_printing(cairo_surface_t*)
+     */
+    [[nodiscard]] std::vector<uint8_t> rasterize(const RenderedLabel *rendered) const override;
+    void rasterize(const RenderedLabel *rendered, std::vector<uint8_t>& printing_data) const override;
+
+    /**
+     * Renders strips of the label with the default `ProductLabelCreator` (always with cairo), each of
+     * them as a whole - static layer and raster cache are not used. Dates are formatted only once,
+     * so all of the strips show the same dates.
+     *
+     * @see ProductLabelCreator::render_strip()
+     */
+    [[nodiscard]] std::unique_ptr<LabelStrips> render_strips() const override;
+
     friend class ProductLabelCreator;
+    friend class ProductLabelBenchmark;  /**< Benchmarks of the steps of rendering, see bench/micro_benchmark.cpp */
 };
 
 
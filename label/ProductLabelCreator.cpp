@@ -1,40 +1,89 @@
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <ctime>
+#include <tuple>
 #include <iomanip>
 #include <yaml-cpp/yaml.h>
 
 #include "ProductLabelCreator.h"
+#include "../utils/Tracer.h"
 
-ProductLabelCreator ProductLabelCreator::_inst {};
+using namespace ProductLabelLayout;
 
-void ProductLabelCreator::load_config(const std::string& _config_file) {
-    _inst.config_file = _config_file;
-    YAML::Node root = YAML::LoadFile(_inst.config_file);
+std::shared_ptr<const ProductLabelConfig> ProductLabelCreator::default_config {};
+std::atomic<cairo_format_t> ProductLabelCreator::default_surface_format {CAIRO_FORMAT_RGB24};
+std::atomic<TextEngine> ProductLabelCreator::default_text_engine {TextEngine::CAIRO};
+RasterCache ProductLabelCreator::raster_cache {};
+BufferPool ProductLabelCreator::surface_buffers {};
+ObjectPool<std::vector<uint8_t>> ProductLabelCreator::surface_memory {};
+
+namespace {
+    const cairo_user_data_key_t SURFACE_MEMORY_KEY {};
+}
+
+namespace {
+    /**
+     * Surface-less cairo context for measuring text, one per thread.
+     */
+    struct MeasuringContext {
+        cairo_surface_t *surface;
+        cairo_t *cr;
+
+        MeasuringContext() noexcept
+            : surface(cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1)),
+            cr(cairo_create(surface)) {}
+
+        ~MeasuringContext() {
+            cairo_destroy(cr);
+            cairo_surface_destroy(surface);
+        }
+
+        MeasuringContext(const MeasuringContext&) = delete;
+        MeasuringContext& operator=(const MeasuringContext&) = delete;
+    };
+}
+
+ProductLabelCreator::ProductLabelCreator(std::shared_ptr<const ProductLabelConfig> _config, const cairo_format_t _surface_format,
+        const TextEngine _text_engine)
+    : config(std::move(_config)),
+    surface_format(_surface_format),
+    text_engine(_text_engine) {
+    if(!config)
+        throw std::invalid_argument("Product label creator needs a config");
+    if(surface_format != CAIRO_FORMAT_RGB24 && surface_format != CAIRO_FORMAT_A8 && surface_format != CAIRO_FORMAT_A1)
+        throw std::invalid_argument("Label surface format must be RGB24, A8 or A1");
+}
+
+std::shared_ptr<const ProductLabelConfig> ProductLabelCreator::parse_config(const std::string& _config_file) {
+    auto config = std::make_shared<ProductLabelConfig>();
+    config->config_file = _config_file;
+    YAML::Node root = YAML::LoadFile(config->config_file);
 
-    _inst.global_font = {
+    config->global_font = {
         root["global_font"]["face"].as<std::string>(),
         __slants.at(root["global_font"]["slant"].as<std::string>()),
         __weights.at(root["global_font"]["weight"].as<std::string>())
     };
 
-    _inst.date_format = root["date_format"].as<std::string>();
+    config->date_format = root["date_format"].as<std::string>();
 
-    _inst.start_date_text = root["start_date_text"].as<std::string>();
-    _inst.ready_date_text = root["ready_date_text"].as<std::string>();
-    _inst.discard_date_text = root["discard_date_text"].as<std::string>();
+    config->start_date_text = root["start_date_text"].as<std::string>();
+    config->ready_date_text = root["ready_date_text"].as<std::string>();
+    config->discard_date_text = root["discard_date_text"].as<std::string>();
 
-    _inst.usage_board_text = root["usage_texts"]["board"].as<std::string>();
-    _inst.usage_prep_text = root["usage_texts"]["prep"].as<std::string>();
-    _inst.usage_storage_text = root["usage_texts"]["storage"].as<std::string>();
+    config->usage_board_text = root["usage_texts"]["board"].as<std::string>();
+    config->usage_prep_text = root["usage_texts"]["prep"].as<std::string>();
+    config->usage_storage_text = root["usage_texts"]["storage"].as<std::string>();
 
-    _inst.guide_width = root["guide_width"].as<double>();
-    _inst.text_box_margin_x = root["text_box_margins"]["x"].as<double>();
-    _inst.text_box_margin_y = root["text_box_margins"]["y"].as<double>();
+    config->guide_width = root["guide_width"].as<double>();
+    config->text_box_margin_x = root["text_box_margins"]["x"].as<double>();
+    config->text_box_margin_y = root["text_box_margins"]["y"].as<double>();
 
     for(const auto& guide: root["guides"]) {
         const Point start {guide["start"]["x"].as<double>(), guide["start"]["y"].as<double>()};
         const Point end {guide["end"]["x"].as<double>(), guide["end"]["y"].as<double>()};
-        _inst.guides.push_back({start, end});
+        config->guides.push_back({start, end});
     }
 
     for(const auto& text_box: root["text_boxes"]) {
@@ -45,58 +94,268 @@ void ProductLabelCreator::load_config(const std::string& _config_file) {
         std::optional<Font> font;
         if(text_box["font"]) {
             font = {
-                text_box["font"]["face"] ? text_box["font"]["face"].as<std::string>() : _inst.global_font.face,
-                text_box["font"]["slant"] ? __slants.at(text_box["font"]["slant"].as<std::string>()) : _inst.global_font.slant,
-                text_box["font"]["weight"] ? __weights.at(text_box["font"]["weight"].as<std::string>()) : _inst.global_font.weight
+                text_box["font"]["face"] ? text_box["font"]["face"].as<std::string>() : config->global_font.face,
+                text_box["font"]["slant"] ? __slants.at(text_box["font"]["slant"].as<std::string>()) : config->global_font.slant,
+                text_box["font"]["weight"] ? __weights.at(text_box["font"]["weight"].as<std::string>()) : config->global_font.weight
             };
         }
         else font = std::nullopt;
 
-        _inst.text_boxes[bind_to] = {font, align, bottom_left, top_right};
+        config->text_boxes[bind_to] = {font, align, bottom_left, top_right};
     }
+
+    return config;
+}
+
+ProductLabelCreator ProductLabelCreator::get_default() {
+    std::shared_ptr<const ProductLabelConfig> config = std::atomic_load(&default_config);
+    if(!config)
+        throw std::runtime_error("No config loaded! Use ProductLabelCreator::load_config first");
+    return ProductLabelCreator(std::move(config), default_surface_format, default_text_engine);
+}
+
+void ProductLabelCreator::load_config(const std::string& _config_file) {
+    TraceSpan span("load_config", "config");
+    std::atomic_store(&default_config, parse_config(_config_file));
+    raster_cache.clear();
 }
 
-inline void ProductLabelCreator::reload_config() {
-    if(_inst.config_file.empty())
+void ProductLabelCreator::reload_config() {
+    const std::shared_ptr<const ProductLabelConfig> config = std::atomic_load(&default_config);
+    if(!config || config->config_file.empty())
         throw std::runtime_error("No config file to reload");
-    ProductLabelCreator::load_config(_inst.config_file);
+    ProductLabelCreator::load_config(config->config_file);
+}
+
+void ProductLabelCreator::set_surface_format(const cairo_format_t format) {
+    if(format != CAIRO_FORMAT_RGB24 && format != CAIRO_FORMAT_A8 && format != CAIRO_FORMAT_A1)
+        throw std::invalid_argument("Label surface format must be RGB24, A8 or A1");
+    default_surface_format = format;
+}
+
+cairo_format_t ProductLabelCreator::get_surface_format() noexcept {
+    return default_surface_format;
+}
+
+void ProductLabelCreator::set_text_engine(const TextEngine engine) noexcept {
+    default_text_engine = engine;
+}
+
+TextEngine ProductLabelCreator::get_text_engine() noexcept {
+    return default_text_engine;
+}
+
+RasterCache& ProductLabelCreator::get_raster_cache() noexcept {
+    return raster_cache;
 }
 
 cairo_surface_t *ProductLabelCreator::create_label_surface(const ProductLabel& label) {
-    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, ProductLabel::dimensions.width_pt, ProductLabel::dimensions.height_pt);
+    return get_default().render(label);
+}
+
+void ProductLabelCreator::export_to_png(const ProductLabel& label, const std::string& filename) {
+    get_default().write_png(label, filename);
+}
+
+const ProductLabelConfig& ProductLabelCreator::get_config() const noexcept {
+    return *config;
+}
+
+bool StaticLayerCache::Key::operator==(const Key& other) const noexcept {
+    return format == other.format
+        && ready_date == other.ready_date
+        && surface_format == other.surface_format
+        && threshold == other.threshold;
+}
+
+bool FontSizeCache::Key::operator<(const Key& other) const noexcept {
+    return std::tie(text, bind, face, slant, weight, width_pt, height_pt)
+        < std::tie(other.text, other.bind, other.face, other.slant, other.weight, other.width_pt, other.height_pt);
+}
+
+std::optional<double> FontSizeCache::find(const Key& key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto it = sizes.find(key);
+    if(it == sizes.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void FontSizeCache::insert(const Key& key, const double font_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sizes.emplace(key, font_size);
+}
+
+cairo_format_t ProductLabelCreator::get_output_format() const noexcept {
+    return surface_format;
+}
+
+TextEngine ProductLabelCreator::get_engine() const noexcept {
+    return text_engine;
+}
+
+ProductLabelDates ProductLabelCreator::format_dates(const ProductLabel& label) const {
+    ProductLabelDates dates {};
+    format_dates(label, dates);
+    return dates;
+}
+
+void ProductLabelCreator::format_dates(const ProductLabel& label, ProductLabelDates& dates) const {
+    const auto now = label.start_date ? std::chrono::system_clock::from_time_t(label.start_date.value()) : std::chrono::system_clock::now();
+
+    date_to_str(now, dates.start);
+    if(label.ready_date) {
+        if(!dates.ready)
+            dates.ready.emplace();
+        date_to_str(now + detect_duration(label.ready_date.value()), dates.ready.value());
+    }
+    else
+        dates.ready.reset();
+    date_to_str(now + detect_duration(label.discard_date), dates.discard);
+}
+
+template<typename F>
+void ProductLabelCreator::for_each_date(const ProductLabelDates& dates, F&& f) {
+    const std::string *ready = dates.ready ? &dates.ready.value() : nullptr;
+
+    if(ready != nullptr)
+        f(*ready, Binding::READY_DATE);
+    if(ready == nullptr || dates.start != *ready)
+        f(dates.start, Binding::START_DATE);
+    if(dates.discard != dates.start && (ready == nullptr || dates.discard != *ready))
+        f(dates.discard, Binding::DISCARD_DATE);
+}
+
+cairo_surface_t *ProductLabelCreator::render(const ProductLabel& label) const {
+    return render(label, format_dates(label));
+}
+
+cairo_surface_t *ProductLabelCreator::render(const ProductLabel& label, const ProductLabelDates& dates) const {
+    const LabelDimensions& dimensions = label.get_format().dimensions;
+
+    cairo_surface_t *surface = create_blank_surface(dimensions);
+    cairo_t *cr = cairo_create(surface);
+
+    const double date_font_size = draw_static(cr, dimensions, label.ready_date.has_value());
+    draw_dynamic(cr, dimensions, label, dates, date_font_size);
+
+    cairo_surface_flush(surface);
+    cairo_destroy(cr);
+
+    return surface;
+}
+
+std::shared_ptr<const StaticLayer> ProductLabelCreator::get_static_layer(const LabelFormat& format,
+        const bool ready_date, const uint8_t threshold) const {
+    return config->static_layers.get({format, ready_date, surface_format, threshold}, [&] {
+        cairo_surface_t *surface = create_blank_surface(format.dimensions);
+        cairo_t *cr = cairo_create(surface);
+
+        StaticLayer layer {};
+        layer.date_font_size = draw_static(cr, format.dimensions, ready_date);
+
+        cairo_surface_flush(surface);
+        cairo_destroy(cr);
+
+        try {
+            layer.printing_data = ProductLabel::prepare_for_printing(surface, format.dimensions, threshold);
+        }
+        catch(...) {
+            cairo_surface_destroy(surface);
+            throw;
+        }
+        cairo_surface_destroy(surface);
+
+        return layer;
+    });
+}
+
+cairo_surface_t *ProductLabelCreator::render_dynamic(const ProductLabel& label, const ProductLabelDates& dates,
+        const StaticLayer& static_layer) const {
+    const LabelDimensions& dimensions = label.get_format().dimensions;
+
+    cairo_surface_t *surface = create_blank_surface(dimensions);
+    cairo_t *cr = cairo_create(surface);
+
+    draw_dynamic(cr, dimensions, label, dates, static_layer.date_font_size);
+
+    cairo_surface_flush(surface);
+    cairo_destroy(cr);
+
+    return surface;
+}
+
+cairo_surface_t *ProductLabelCreator::render_strip(const ProductLabel& label, const ProductLabelDates& dates,
+        const uint32_t first_column, const uint32_t columns) const {
+    const LabelDimensions& dimensions = label.get_format().dimensions;
+    if(columns == 0 || first_column >= dimensions.width_pt || columns > dimensions.width_pt - first_column)
+        throw std::invalid_argument("Strip must be a non-empty part of the label");
+
+    LabelDimensions strip_dimensions = dimensions;
+    strip_dimensions.width_pt = columns;
+
+    cairo_surface_t *surface = create_blank_surface(strip_dimensions);
     cairo_t *cr = cairo_create(surface);
 
-    /* Draw background */
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_paint(cr);
+    // Everything is laid out on the whole label, the strip only shifts the origin (by whole pixels)
+    cairo_translate(cr, -static_cast<double>(first_column), 0);
+
+    const double date_font_size = draw_static(cr, dimensions, label.ready_date.has_value());
+    draw_dynamic(cr, dimensions, label, dates, date_font_size);
+
+    cairo_surface_flush(surface);
+    cairo_destroy(cr);
+
+    return surface;
+}
+
+cairo_surface_t *ProductLabelCreator::create_blank_surface(const LabelDimensions& dimensions) const {
+    const auto width = static_cast<int>(dimensions.width_pt);
+    const auto height = static_cast<int>(dimensions.height_pt);
+    const int stride = cairo_format_stride_for_width(surface_format, width);
+
+    // Pixels live in a pooled buffer (in a pooled holder), which is returned to the pool when the surface is destroyed
+    std::vector<uint8_t> *memory = surface_memory.acquire().release();
+    *memory = surface_buffers.acquire(static_cast<size_t>(stride) * height);
 
+    /* Draw background (alpha-only surfaces are transparent, which means no ink) */
+    std::fill(memory->begin(), memory->end(), surface_format == CAIRO_FORMAT_RGB24 ? 0xff : 0x00);
+
+    cairo_surface_t *surface = cairo_image_surface_create_for_data(memory->data(), surface_format, width, height, stride);
+    const cairo_status_t status = cairo_surface_set_user_data(surface, &SURFACE_MEMORY_KEY, memory, [](void *data) {
+        std::unique_ptr<std::vector<uint8_t>> pooled(static_cast<std::vector<uint8_t>*>(data));
+        surface_buffers.release(std::move(*pooled));
+        surface_memory.release(std::move(pooled));
+    });
+
+    if(status != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(surface);
+        std::unique_ptr<std::vector<uint8_t>> pooled(memory);
+        surface_buffers.release(std::move(*pooled));
+        surface_memory.release(std::move(pooled));
+        throw std::bad_alloc();
+    }
+
+    return surface;
+}
+
+double ProductLabelCreator::draw_static(cairo_t *cr, const LabelDimensions& dimensions, const bool ready_date) const {
     /* Draw guides */
     cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_set_line_width(cr, _inst.guide_width);
-    for(const auto& guide: _inst.guides) {
-        cairo_move_to(cr, ProductLabel::dimensions.width_pt * guide.start.x, ProductLabel::dimensions.height_pt * guide.start.y);
-        cairo_line_to(cr, ProductLabel::dimensions.width_pt * guide.end.x, ProductLabel::dimensions.height_pt * guide.end.y);
+    cairo_set_line_width(cr, config->guide_width);
+    for(const auto& guide: config->guides) {
+        cairo_move_to(cr, dimensions.width_pt * guide.start.x, dimensions.height_pt * guide.start.y);
+        cairo_line_to(cr, dimensions.width_pt * guide.end.x, dimensions.height_pt * guide.end.y);
     }
     cairo_stroke(cr);
 
-    /* Draw product name */
-    cairo_select_font_face(cr, _inst.global_font.face.c_str(), _inst.global_font.slant, _inst.global_font.weight);
-    std::string product_name = label.name + " (";
-    switch(label.usage) {
-        case ProductUsage::BOARD:   product_name += _inst.usage_board_text;   break;
-        case ProductUsage::PREP:    product_name += _inst.usage_prep_text;    break;
-        case ProductUsage::STORAGE: product_name += _inst.usage_storage_text; break;
-    }
-    product_name += ")";
-
-    _inst.calculate_font_size(cr, product_name, Binding::PRODUCT_NAME);
-    _inst.print_text(cr, product_name, Binding::PRODUCT_NAME);
-
     /* Draw date texts */
+    cairo_select_font_face(cr, config->global_font.face.c_str(), config->global_font.slant, config->global_font.weight);
     std::vector<std::pair<std::string, Binding>> date_texts {
-            {_inst.start_date_text, Binding::START_DATE_TEXT},
-            {_inst.ready_date_text, Binding::READY_DATE_TEXT},
-            {_inst.discard_date_text, Binding::DISCARD_DATE_TEXT}
+            {config->start_date_text, Binding::START_DATE_TEXT},
+            {config->ready_date_text, Binding::READY_DATE_TEXT},
+            {config->discard_date_text, Binding::DISCARD_DATE_TEXT}
     };
 
     // Find the longest date text and set font size for it
@@ -104,96 +363,221 @@ cairo_surface_t *ProductLabelCreator::create_label_surface(const ProductLabel& l
             [](const std::pair<std::string, Binding>& i, const std::pair<std::string, Binding>& k) {
                     return i.first.size() > k.first.size();
     });
-    _inst.calculate_font_size(cr, date_texts[0].first, date_texts[0].second);
+    const double date_font_size = calculate_font_size(cr, dimensions, date_texts[0].first, date_texts[0].second);
 
-    // Remove ready_date_text if the label doesn't have ready_date
-    if(!label.ready_date)
-        date_texts.erase(date_texts.begin() + 1);
+    for(const auto& i: date_texts) {
+        // Skip ready_date_text if the label doesn't have ready_date
+        if(!ready_date && i.second == Binding::READY_DATE_TEXT)
+            continue;
+        print_text(cr, dimensions, i.first, i.second);
+    }
 
-    for(const auto& i: date_texts)
-        _inst.print_text(cr, i.first, i.second);
+    return date_font_size;
+}
 
-    /* Calculate dates */
-    std::map<std::string, Binding> dates {};
+void ProductLabelCreator::draw_dynamic(cairo_t *cr, const LabelDimensions& dimensions, const ProductLabel& label,
+        const ProductLabelDates& label_dates, const double date_font_size) const {
+    cairo_set_source_rgb(cr, 0, 0, 0);
 
-    auto now = label.start_date ? std::chrono::system_clock::from_time_t(label.start_date.value()) : std::chrono::system_clock::now();
-    decltype(now) ready;
-    decltype(now) discard = now + detect_duration(label.discard_date);
+    /* Draw product name */
+    cairo_select_font_face(cr, config->global_font.face.c_str(), config->global_font.slant, config->global_font.weight);
+    thread_local std::string product_name {};
+    get_product_name(label, product_name);
 
-    if(label.ready_date) {
-        ready = now + detect_duration(label.ready_date.value());
-        dates.insert({date_to_str(ready), Binding::READY_DATE});
-    }
+    calculate_font_size(cr, dimensions, product_name, Binding::PRODUCT_NAME);
+    print_text(cr, dimensions, product_name, Binding::PRODUCT_NAME);
+
+    /* Draw dates (with the same font size as date texts) */
+    cairo_set_font_size(cr, date_font_size);
+    for_each_date(label_dates, [&](const std::string& date, const Binding bind) {
+        print_text(cr, dimensions, date, bind);
+    });
+}
+
+std::vector<uint8_t> ProductLabelCreator::render_printing_data(const ProductLabel& label, const ProductLabelDates& dates,
+        const StaticLayer& static_layer, const uint8_t threshold) const {
+    const LabelDimensions& dimensions = label.get_format().dimensions;
+    std::vector<uint8_t> printing_data = static_layer.printing_data;
+
+    /* Draw product name (font size is fitted with cairo, but usually only looked up) */
+    thread_local const MeasuringContext measuring_context {};
+    cairo_t *cr = measuring_context.cr;
+    cairo_select_font_face(cr, config->global_font.face.c_str(), config->global_font.slant, config->global_font.weight);
 
-    dates.insert({date_to_str(now), Binding::START_DATE});
-    dates.insert({date_to_str(discard), Binding::DISCARD_DATE});
+    thread_local std::string product_name {};
+    get_product_name(label, product_name);
+    const double font_size = calculate_font_size(cr, dimensions, product_name, Binding::PRODUCT_NAME);
+    blit_text(printing_data, dimensions, product_name, Binding::PRODUCT_NAME, font_size, threshold);
 
     /* Draw dates */
-    for(const auto& i: dates)
-        _inst.print_text(cr, i.first, i.second);
+    for_each_date(dates, [&](const std::string& date, const Binding bind) {
+        blit_text(printing_data, dimensions, date, bind, static_layer.date_font_size, threshold);
+    });
 
-    cairo_surface_flush(surface);
-    cairo_destroy(cr);
+    return printing_data;
+}
 
-    return surface;
+void ProductLabelCreator::get_product_name(const ProductLabel& label, std::string& product_name) const {
+    product_name.assign(label.name).append(" (");
+    switch(label.usage) {
+        case ProductUsage::BOARD:   product_name += config->usage_board_text;   break;
+        case ProductUsage::PREP:    product_name += config->usage_prep_text;    break;
+        case ProductUsage::STORAGE: product_name += config->usage_storage_text; break;
+    }
+    product_name += ")";
 }
 
-void ProductLabelCreator::calculate_font_size(cairo_t *cr, const std::string &text, Binding bind) {
-    const TextBox& text_box = text_boxes.at(bind);
+double ProductLabelCreator::calculate_font_size(cairo_t *cr, const LabelDimensions& dimensions, const std::string &text,
+        const Binding bind) const {
+    TraceSpan span("calculate_font_size", "render");
+    span.set_arg("binding", static_cast<int64_t>(bind));
+
+    // Strings of the key keep their memory, so looking up a known size doesn't allocate
+    thread_local FontSizeCache::Key key {};
+    key.text = text;
+    key.bind = bind;
+    key.face = config->global_font.face;
+    key.slant = config->global_font.slant;
+    key.weight = config->global_font.weight;
+    key.width_pt = dimensions.width_pt;
+    key.height_pt = dimensions.height_pt;
+    if(const std::optional<double> cached = config->font_sizes.find(key)) {
+        cairo_set_font_size(cr, cached.value());
+        return cached.value();
+    }
 
-    const double max_width = (text_box.top_right.x - text_box.bottom_left.x) * ProductLabel::dimensions.width_pt;
-    const double max_height = (text_box.bottom_left.y - text_box.top_right.y) * ProductLabel::dimensions.height_pt;
+    const TextBox& text_box = config->text_boxes.at(bind);
 
-    cairo_text_extents_t ext;
-    double font_size = max_height * (1 - text_box_margin_y);
-    do {
-        cairo_set_font_size(cr, font_size--);
+    const double max_width = (text_box.top_right.x - text_box.bottom_left.x) * dimensions.width_pt;
+    const double max_height = (text_box.bottom_left.y - text_box.top_right.y) * dimensions.height_pt;
+
+    const double max_font_size = max_height * (1 - config->text_box_margin_y);
+    const double fit_width = max_width * (1 - config->text_box_margin_x);
+
+    const auto fits = [&](const double font_size) {
+        cairo_text_extents_t ext;
+        cairo_set_font_size(cr, font_size);
         cairo_text_extents(cr, text.c_str(), &ext);
-    } while(ext.width > max_width * (1 - text_box_margin_x));
+        return ext.width <= fit_width;
+    };
+
+    /*
+    Font sizes are tried from `max_font_size` down by 1pt and the first one that fits is used. Text width
+    is almost proportional to the font size, so a single measurement at `max_font_size` tells which sizes
+    surely don't fit and the scan starts below them. Hinting rounds the width of each glyph by less than
+    a pixel, so the bound allows for a pixel per byte of the text, both in the measurement and at the
+    skipped sizes - the chosen size is the same as with the scan from the top.
+    */
+    double font_size = max_font_size;
+    cairo_text_extents_t ext;
+    cairo_set_font_size(cr, font_size);
+    cairo_text_extents(cr, text.c_str(), &ext);
+
+    if(ext.width > fit_width) {
+        const auto rounding = static_cast<double>(text.size());
+        if(ext.width > rounding) {
+            const double largest_fitting = max_font_size * (fit_width + rounding) / (ext.width - rounding);
+            font_size -= std::max(std::ceil(max_font_size - largest_fitting), 1.0);
+        }
+        else
+            font_size -= 1;
+
+        while(!fits(font_size))
+            font_size -= 1;
+    }
+
+    config->font_sizes.insert(key, font_size);
+    return font_size;
 }
 
-void ProductLabelCreator::print_text(cairo_t *cr, const std::string& text, const Binding bind) {
-    const TextBox& text_box = text_boxes.at(bind);
+void ProductLabelCreator::print_text(cairo_t *cr, const LabelDimensions& dimensions, const std::string& text,
+        const Binding bind) const {
+    TraceSpan span("print_text", "render");
+    span.set_arg("binding", static_cast<int64_t>(bind));
+
+    const TextBox& text_box = config->text_boxes.at(bind);
 
     cairo_text_extents_t ext;
     cairo_text_extents(cr, text.c_str(), &ext);
+    const Point position = text_position(dimensions, ext, bind);
+
+    if(text_box.font)
+        cairo_select_font_face(cr, text_box.font->face.c_str(), text_box.font->slant, text_box.font->weight);
 
-    const double max_width = (text_box.top_right.x - text_box.bottom_left.x) * ProductLabel::dimensions.width_pt;
-    const double max_height = (text_box.bottom_left.y - text_box.top_right.y) * ProductLabel::dimensions.height_pt;
+    cairo_move_to(cr, position.x, position.y);
+    cairo_show_text(cr, text.c_str());
+
+    // Revert font face back to global
+    if(text_box.font)
+        cairo_select_font_face(cr, config->global_font.face.c_str(), config->global_font.slant, config->global_font.weight);
+}
 
-    const double tr_x = text_box.top_right.x * ProductLabel::dimensions.width_pt;
-    const double bl_x = text_box.bottom_left.x * ProductLabel::dimensions.width_pt;
-    const double bl_y = text_box.bottom_left.y * ProductLabel::dimensions.height_pt;
+void ProductLabelCreator::blit_text(std::vector<uint8_t>& printing_data, const LabelDimensions& dimensions,
+        const std::string& text, const Binding bind, const double font_size, const uint8_t threshold) const {
+    const TextBox& text_box = config->text_boxes.at(bind);
+    const Font& global_font = config->global_font;
+    const std::u32string decoded = GlyphAtlas::decode_utf8(text);
+
+    std::shared_ptr<GlyphAtlas> atlas = config->glyph_atlases.get(global_font.face, global_font.slant,
+            global_font.weight, font_size, threshold);
+    const Point position = text_position(dimensions, atlas->measure(decoded), bind);
+
+    if(text_box.font) {
+        atlas = config->glyph_atlases.get(text_box.font->face, text_box.font->slant, text_box.font->weight,
+                font_size, threshold);
+    }
+
+    atlas->draw(decoded, position.x, position.y, printing_data.data(), dimensions.width_pt, dimensions.height_pt);
+}
+
+Point ProductLabelCreator::text_position(const LabelDimensions& dimensions, const cairo_text_extents_t& ext,
+        const Binding bind) const {
+    const TextBox& text_box = config->text_boxes.at(bind);
+
+    const double max_width = (text_box.top_right.x - text_box.bottom_left.x) * dimensions.width_pt;
+    const double max_height = (text_box.bottom_left.y - text_box.top_right.y) * dimensions.height_pt;
+
+    const double tr_x = text_box.top_right.x * dimensions.width_pt;
+    const double bl_x = text_box.bottom_left.x * dimensions.width_pt;
+    const double bl_y = text_box.bottom_left.y * dimensions.height_pt;
 
     double text_x, text_y;
 
     switch(text_box.align) {
         case Align::LEFT:
-            text_x = bl_x + max_width * (text_box_margin_x / 2);
+            text_x = bl_x + max_width * (config->text_box_margin_x / 2);
             break;
         case Align::CENTER:
             text_x = bl_x + (max_width - ext.width) / 2;
             break;
         case Align::RIGHT:
-            text_x = tr_x - ext.x_advance - max_width * (text_box_margin_x / 2);
+            text_x = tr_x - ext.x_advance - max_width * (config->text_box_margin_x / 2);
             break;
     }
 
     text_y = bl_y - (ext.height + ext.y_bearing) - (max_height - ext.height) / 2;
 
-    if(text_box.font)
-        cairo_select_font_face(cr, text_box.font->face.c_str(), text_box.font->slant, text_box.font->weight);
+    return {text_x, text_y};
+}
 
-    cairo_move_to(cr, text_x, text_y);
-    cairo_show_text(cr, text.c_str());
+void ProductLabelCreator::write_png(const ProductLabel &label, const std::string& filename) const {
+    cairo_surface_t *surface = render(label);
 
-    // Revert font face back to global
-    if(text_box.font)
-        cairo_select_font_face(cr, global_font.face.c_str(), global_font.slant, global_font.weight);
-}
+    if(cairo_image_surface_get_format(surface) != CAIRO_FORMAT_RGB24) {
+        cairo_surface_t *preview = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface));
+        cairo_t *cr = cairo_create(preview);
+
+        cairo_set_source_rgb(cr, 1, 1, 1);
+        cairo_paint(cr);
+        cairo_set_source_rgb(cr, 0, 0, 0);
+        cairo_mask_surface(cr, surface, 0, 0);
+
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+        surface = preview;
+    }
 
-void ProductLabelCreator::export_to_png(const ProductLabel &label, const std::string& filename) {
-    cairo_surface_t *surface = ProductLabelCreator::create_label_surface(label);
     cairo_surface_write_to_png(surface, filename.c_str());
     cairo_surface_destroy(surface);
 }
@@ -212,13 +596,20 @@ std::chrono::hours ProductLabelCreator::detect_duration(const std::string &date)
     return std::chrono::hours(interval);
 }
 
-std::string ProductLabelCreator::date_to_str(const std::chrono::system_clock::time_point& base) {
-    std::stringstream buffer {};
-
+void ProductLabelCreator::date_to_str(const std::chrono::system_clock::time_point& base, std::string& formatted) const {
     const std::time_t base_time = std::chrono::system_clock::to_time_t(base);
-    const std::tm *t = std::localtime(&base_time);
-
-    buffer << std::put_time(t, _inst.date_format.c_str());
+    std::tm t {};
+    localtime_r(&base_time, &t);  // std::localtime is not reentrant
+
+    // `std::put_time` is defined by `std::strftime`, which doesn't need a stream (and doesn't allocate)
+    char buffer[128];
+    if(const size_t length = std::strftime(buffer, sizeof(buffer), config->date_format.c_str(), &t); length > 0) {
+        formatted.assign(buffer, length);
+        return;
+    }
 
-    return buffer.str();
+    // Too long (or empty) dates
+    std::stringstream stream {};
+    stream << std::put_time(&t, config->date_format.c_str());
+    formatted = stream.str();
 }
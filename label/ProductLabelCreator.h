@@ -1,16 +1,31 @@
 #ifndef LABEL_PRINTER_DRIVER_PRODUCTLABELCREATOR_H
 #define LABEL_PRINTER_DRIVER_PRODUCTLABELCREATOR_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <chrono>
 #include <cairo/cairo.h>
 
 #include "Label.h"
 #include "ProductLabel.h"
+#include "RasterCache.h"
+#include "GlyphAtlas.h"
+#include "../utils/BufferPool.h"
+#include "../utils/ObjectPool.h"
 
-namespace {
+/**
+ * Namespace for parts of the product label layout which are read from config file
+ * (guides, text boxes and their fonts).
+ *
+ * For each enum type there is corresponding map which translates its config values.
+ *
+ * @see ProductLabelConfig
+ */
+namespace ProductLabelLayout {
     struct Point {
         double x;
         double y;
@@ -76,9 +91,90 @@ namespace {
     };
 }
 
-class ProductLabelCreator {
+/**
+ * Parts of a product label which depend only on the config and the media - guides and date
+ * captions - in the form of printing data.
+ *
+ * @see ProductLabelCreator::get_static_layer(const LabelFormat&, bool, uint8_t)
+ */
+struct StaticLayer {
+    std::vector<uint8_t> printing_data;
+    double date_font_size {};  /**< Font size of date captions, which is used for dates too */
+};
+
+/**
+ * Static layers rendered with one config, one for each combination of media format,
+ * presence of ready date, surface format and threshold.
+ */
+class StaticLayerCache {
+public:
+    struct Key {
+        LabelFormat format;
+        bool ready_date;
+        cairo_format_t surface_format;
+        uint8_t threshold;
+
+        bool operator==(const Key& other) const noexcept;
+    };
+
 private:
-    Font global_font;
+    std::vector<std::pair<Key, std::shared_ptr<const StaticLayer>>> layers;  /**< There are only a few variants */
+    std::mutex mutex;
+
+public:
+    /**
+     * @param key Variant of the static layer
+     * @param render Function which renders the layer if it isn't cached yet (it's not wrapped
+     * in `std::function`, so that looking up a cached layer doesn't allocate)
+     * @return Cached or newly rendered layer
+     */
+    template<typename Render>
+    [[nodiscard]] std::shared_ptr<const StaticLayer> get(const Key& key, Render&& render) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for(const auto& [layer_key, layer]: layers) {
+            if(layer_key == key)
+                return layer;
+        }
+
+        auto layer = std::make_shared<const StaticLayer>(render());
+        layers.emplace_back(key, layer);
+        return layer;
+    }
+};
+
+/**
+ * Font sizes found by `ProductLabelCreator::calculate_font_size()` with one config. Only product
+ * names and date captions are fitted, so the number of entries is bounded by label definitions.
+ */
+class FontSizeCache {
+public:
+    struct Key {
+        std::string text;
+        ProductLabelLayout::Binding bind;
+        std::string face;
+        cairo_font_slant_t slant;
+        cairo_font_weight_t weight;
+        uint32_t width_pt;
+        uint32_t height_pt;
+
+        bool operator<(const Key& other) const noexcept;
+    };
+
+private:
+    std::map<Key, double> sizes;
+    mutable std::mutex mutex;
+
+public:
+    [[nodiscard]] std::optional<double> find(const Key& key) const;
+    void insert(const Key& key, double font_size);
+};
+
+/**
+ * Immutable label layout loaded from config file, shared by all `ProductLabelCreator` instances.
+ */
+struct ProductLabelConfig {
+    ProductLabelLayout::Font global_font;
 
     std::string start_date_text;
     std::string ready_date_text;
@@ -94,27 +190,282 @@ private:
     double text_box_margin_x {};
     double text_box_margin_y {};
 
-    std::vector<Guide> guides;
-    std::map<Binding, TextBox> text_boxes;
+    std::vector<ProductLabelLayout::Guide> guides;
+    std::map<ProductLabelLayout::Binding, ProductLabelLayout::TextBox> text_boxes;
 
     std::string config_file;
 
-    void calculate_font_size(cairo_t *cr, const std::string& text, Binding bind);
-    void print_text(cairo_t *cr, const std::string& text, Binding bind);
+    mutable StaticLayerCache static_layers;  /**< Static layers rendered with this config */
+    mutable FontSizeCache font_sizes;  /**< Font sizes fitted with this config */
+    mutable GlyphAtlasCache glyph_atlases;  /**< Glyphs of fonts used by this config */
+};
 
-    static std::chrono::hours detect_duration(const std::string& date);
-    static std::string date_to_str(const std::chrono::system_clock::time_point& date);
+/**
+ * Dates of a `ProductLabel` formatted according to the config.
+ */
+struct ProductLabelDates {
+    std::string start;
+    std::optional<std::string> ready;
+    std::string discard;
+};
+
+/**
+ * Renders `ProductLabel`s according to the layout from config file.
+ *
+ * Instances only read their (immutable, shared) config, so each thread can have
+ * its own creator and render labels at the same time. Static functions use the
+ * process-wide default creator, which is set up with `load_config(const std::string&)`.
+ */
+class ProductLabelCreator {
+private:
+    std::shared_ptr<const ProductLabelConfig> config;
+    cairo_format_t surface_format;
+    TextEngine text_engine;
+
+    /**
+     * Sets the biggest font size (in whole points from the text box height down) at which
+     * the text fits into its text box. Found sizes are remembered in the config.
+     *
+     * @return The font size that was set
+     */
+    double calculate_font_size(cairo_t *cr, const LabelDimensions& dimensions, const std::string& text,
+            ProductLabelLayout::Binding bind) const;
+    void print_text(cairo_t *cr, const LabelDimensions& dimensions, const std::string& text,
+            ProductLabelLayout::Binding bind) const;
+
+    /**
+     * Formats product name of the label with its usage into `product_name`, whose memory is reused.
+     */
+    void get_product_name(const ProductLabel& label, std::string& product_name) const;
+
+    /**
+     * Calls `f(text, binding)` for each date of the label with its text box. A date with the same text
+     * as one passed before (in the order ready, start, discard date) is skipped, so it's drawn only once.
+     */
+    template<typename F>
+    static void for_each_date(const ProductLabelDates& dates, F&& f);
+
+    /**
+     * @return Position of the origin of text with extents `ext` aligned in its text box
+     */
+    [[nodiscard]] ProductLabelLayout::Point text_position(const LabelDimensions& dimensions,
+            const cairo_text_extents_t& ext, ProductLabelLayout::Binding bind) const;
+
+    /**
+     * Draws text with `GlyphAtlas` into printing data. Like `print_text()`, the text is
+     * positioned according to the global font and drawn with the font of its text box.
+     */
+    void blit_text(std::vector<uint8_t>& printing_data, const LabelDimensions& dimensions, const std::string& text,
+            ProductLabelLayout::Binding bind, double font_size, uint8_t threshold) const;
+
+    /**
+     * Creates surface with white background, whose pixel memory is taken from `surface_buffers`
+     * (in a holder from `surface_memory`).
+     */
+    [[nodiscard]] cairo_surface_t *create_blank_surface(const LabelDimensions& dimensions) const;
 
+    /**
+     * Draws guides and date captions.
+     *
+     * @return Font size of date captions
+     */
+    double draw_static(cairo_t *cr, const LabelDimensions& dimensions, bool ready_date) const;
 
-    ProductLabelCreator() = default;
-    static ProductLabelCreator _inst;
+    /**
+     * Draws product name and dates.
+     */
+    void draw_dynamic(cairo_t *cr, const LabelDimensions& dimensions, const ProductLabel& label,
+            const ProductLabelDates& dates, double date_font_size) const;
+
+    static std::chrono::hours detect_duration(const std::string& date);
+    /**
+     * Formats the date into `formatted`, whose memory is reused.
+     */
+    void date_to_str(const std::chrono::system_clock::time_point& date, std::string& formatted) const;
+
+    static std::shared_ptr<const ProductLabelConfig> default_config;
+    static std::atomic<cairo_format_t> default_surface_format;
+    static std::atomic<TextEngine> default_text_engine;
+    static RasterCache raster_cache;
+    static BufferPool surface_buffers;  /**< Pixel memory of label surfaces */
+    static ObjectPool<std::vector<uint8_t>> surface_memory;  /**< Holders of pixel memory passed to cairo */
 
 public:
+    /**
+     * @param config Loaded config (see `parse_config(const std::string&)`)
+     * @param surface_format Format of created surfaces (see `set_surface_format(cairo_format_t)`)
+     * @param text_engine Engine which draws text of printed labels (see `set_text_engine(TextEngine)`)
+     *
+     * @throws std::invalid_argument if `config` is null or `surface_format` is not supported
+     */
+    explicit ProductLabelCreator(std::shared_ptr<const ProductLabelConfig> config,
+            cairo_format_t surface_format = CAIRO_FORMAT_RGB24, TextEngine text_engine = TextEngine::CAIRO);
+
+    /**
+     * Loads label layout from a config file (in YAML format).
+     *
+     * @param config_file Path to the config file
+     * @return Loaded config which can be shared between creators
+     */
+    [[nodiscard]] static std::shared_ptr<const ProductLabelConfig> parse_config(const std::string& config_file);
+
+    /**
+     * @return Copy of the default creator, which can be used by a single thread
+     *
+     * @throws std::runtime_error if no config has been loaded yet
+     */
+    [[nodiscard]] static ProductLabelCreator get_default();
+
+    /**
+     * Loads config file and sets it as config of the default creator.
+     *
+     * Renders which are already running keep using the previous config. Raster cache
+     * is cleared, because the cached labels were rendered with the previous config.
+     */
     static void load_config(const std::string& config_file);
-    inline static void reload_config();
 
+    /**
+     * Loads config of the default creator again from the same file.
+     *
+     * @throws std::runtime_error if no config has been loaded yet
+     */
+    static void reload_config();
+
+    /**
+     * Sets format of surfaces created by `create_label_surface(const ProductLabel&)`.
+     *
+     * `CAIRO_FORMAT_A8` and `CAIRO_FORMAT_A1` surfaces hold only ink coverage (alpha), so
+     * they take 4 and 32 times less memory than `CAIRO_FORMAT_RGB24` and they don't have to
+     * be converted to grayscale before printing.
+     *
+     * @param format One of `CAIRO_FORMAT_RGB24` (default), `CAIRO_FORMAT_A8` or `CAIRO_FORMAT_A1`
+     *
+     * @throws std::invalid_argument if `format` is not supported
+     */
+    static void set_surface_format(cairo_format_t format);
+    static cairo_format_t get_surface_format() noexcept;
+
+    /**
+     * Sets engine which draws product name and dates of labels printed with the default creator.
+     *
+     * `TextEngine::GLYPH_ATLAS` skips cairo surfaces and surface conversion altogether - text is
+     * blitted from cached 1-bit glyphs straight into printing data (static layer is still drawn
+     * by cairo, but only once). Glyphs are placed on whole pixels, so the output can differ from
+     * `TextEngine::CAIRO` by a pixel here and there (every black pixel of one has a black pixel at
+     * most one pixel away in the other). Surfaces created for preview
+     * (`create_label_surface(const ProductLabel&)`, `export_to_png()`) are always drawn by cairo.
+     *
+     * @param engine `TextEngine::CAIRO` (default) or `TextEngine::GLYPH_ATLAS`
+     */
+    static void set_text_engine(TextEngine engine) noexcept;
+    static TextEngine get_text_engine() noexcept;
+
+    /**
+     * Cache of printing data of labels rendered with the default creator.
+     *
+     * @see ProductLabel::render()
+     */
+    [[nodiscard]] static RasterCache& get_raster_cache() noexcept;
+
+    /**
+     * Renders the label with the default creator.
+     *
+     * @see render(const ProductLabel&)
+     */
     [[nodiscard]] static cairo_surface_t *create_label_surface(const ProductLabel& label);
+
+    /**
+     * Saves the label rendered by the default creator as PNG image.
+     *
+     * @see write_png(const ProductLabel&, const std::string&)
+     */
     static void export_to_png(const ProductLabel& label, const std::string& filename);
+
+    /**
+     * Renders the label. Caller is responsible for destroying the returned surface.
+     */
+    [[nodiscard]] cairo_surface_t *render(const ProductLabel& label) const;
+
+    /**
+     * Renders the label with already formatted dates.
+     *
+     * @see format_dates(const ProductLabel&)
+     */
+    [[nodiscard]] cairo_surface_t *render(const ProductLabel& label, const ProductLabelDates& dates) const;
+
+    /**
+     * Returns guides and date captions of labels with given media in the form of printing data.
+     * The layer is rendered only once for each config and variant.
+     *
+     * @param format Media format of the label
+     * @param ready_date Whether the label has a ready date (and so a ready date caption)
+     * @param threshold Black/white threshold used for rasterization
+     */
+    [[nodiscard]] std::shared_ptr<const StaticLayer> get_static_layer(const LabelFormat& format, bool ready_date,
+            uint8_t threshold) const;
+
+    /**
+     * Renders only product name and dates of the label. Printing data of the whole label
+     * is a bitwise OR of printing data of this surface and of the static layer.
+     *
+     * @param label Label to render
+     * @param dates Formatted dates of the label
+     * @param static_layer Static layer of the label (its date font size is used)
+     *
+     * @see get_static_layer(const LabelFormat&, bool, uint8_t)
+     */
+    [[nodiscard]] cairo_surface_t *render_dynamic(const ProductLabel& label, const ProductLabelDates& dates,
+            const StaticLayer& static_layer) const;
+
+    /**
+     * Draws product name and dates of the label with `GlyphAtlas` straight into a copy
+     * of printing data of the static layer.
+     *
+     * @param label Label to render
+     * @param dates Formatted dates of the label
+     * @param static_layer Static layer of the label
+     * @param threshold Black/white threshold of glyphs (should be the same as of the static layer)
+     * @return Printing data of the whole label
+     */
+    [[nodiscard]] std::vector<uint8_t> render_printing_data(const ProductLabel& label, const ProductLabelDates& dates,
+            const StaticLayer& static_layer, uint8_t threshold) const;
+
+    /**
+     * Renders `columns` columns of the label starting with `first_column` - guides, captions,
+     * product name and dates, laid out for the whole label. Pixels of the strip are the same as
+     * pixels of the same columns of `render(const ProductLabel&, const ProductLabelDates&)`.
+     * Caller is responsible for destroying the returned surface.
+     *
+     * @param label Label to render
+     * @param dates Formatted dates of the label
+     * @param first_column Index of the first column of the strip
+     * @param columns Number of columns of the strip (width of the surface)
+     *
+     * @throws std::invalid_argument if the strip is empty or it doesn't lie within the label
+     */
+    [[nodiscard]] cairo_surface_t *render_strip(const ProductLabel& label, const ProductLabelDates& dates,
+            uint32_t first_column, uint32_t columns) const;
+
+    /**
+     * Calculates dates of the label (from its start date or from the current time)
+     * and formats them according to the config.
+     */
+    [[nodiscard]] ProductLabelDates format_dates(const ProductLabel& label) const;
+
+    /**
+     * Same as above, but formats the dates into `dates`, so that strings which already have
+     * enough capacity are reused.
+     */
+    void format_dates(const ProductLabel& label, ProductLabelDates& dates) const;
+
+    /**
+     * Saves the label as PNG image. Alpha-only surfaces are composed onto white background first.
+     */
+    void write_png(const ProductLabel& label, const std::string& filename) const;
+
+    [[nodiscard]] const ProductLabelConfig& get_config() const noexcept;
+    [[nodiscard]] cairo_format_t get_output_format() const noexcept;
+    [[nodiscard]] TextEngine get_engine() const noexcept;
 };
 
 
@@ -0,0 +1,133 @@
+#include <functional>
+
+#include "RasterCache.h"
+
+namespace {
+    inline void hash_combine(size_t& seed, const size_t value) noexcept {
+        seed ^= value + 0x9e3779b9u + (seed << 6u) + (seed >> 2u);
+    }
+}
+
+bool RasterCacheKey::operator==(const RasterCacheKey& other) const noexcept {
+    return name == other.name
+        && usage == other.usage
+        && format == other.format
+        && start_date == other.start_date
+        && ready_date == other.ready_date
+        && discard_date == other.discard_date
+        && threshold == other.threshold
+        && surface_format == other.surface_format
+        && text_engine == other.text_engine;
+}
+
+size_t RasterCacheKeyHash::operator()(const RasterCacheKey& key) const noexcept {
+    const std::hash<std::string> string_hash {};
+
+    size_t seed = string_hash(key.name);
+    hash_combine(seed, static_cast<size_t>(key.usage));
+    hash_combine(seed, static_cast<size_t>(key.format.type));
+    hash_combine(seed, key.format.dimensions.width_pt);
+    hash_combine(seed, key.format.dimensions.height_pt);
+    hash_combine(seed, string_hash(key.start_date));
+    hash_combine(seed, string_hash(key.ready_date));
+    hash_combine(seed, string_hash(key.discard_date));
+    hash_combine(seed, key.threshold);
+    hash_combine(seed, static_cast<size_t>(key.surface_format));
+    hash_combine(seed, static_cast<size_t>(key.text_engine));
+
+    return seed;
+}
+
+RasterCache::RasterCache(const size_t _memory_budget) : memory_budget(_memory_budget) {}
+
+RasterCache::Data RasterCache::find(const RasterCacheKey& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto it = index.find(key);
+    if(it == index.end()) {
+        ++statistics.misses;
+        return nullptr;
+    }
+
+    ++statistics.hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void RasterCache::insert(const RasterCacheKey& key, Data data, const uint64_t _generation) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(!data || _generation != generation || data->size() > memory_budget)
+        return;
+
+    // Another thread could render the same label in the meantime
+    if(const auto it = index.find(key); it != index.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    evict(memory_budget - data->size());
+
+    statistics.bytes += data->size();
+    entries.emplace_front(key, std::move(data));
+    index.emplace(key, entries.begin());
+    statistics.entries = entries.size();
+}
+
+void RasterCache::insert(const RasterCacheKey& key, const std::vector<uint8_t>& data, const uint64_t _generation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(_generation != generation || data.size() > memory_budget)
+            return;
+        if(const auto it = index.find(key); it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+    }
+
+    // Copied outside of the lock, the checks are repeated when it is inserted
+    insert(key, std::make_shared<const std::vector<uint8_t>>(data), _generation);
+}
+
+void RasterCache::evict(const size_t budget) {
+    while(statistics.bytes > budget && !entries.empty()) {
+        const Entry& lru = entries.back();
+        statistics.bytes -= lru.second->size();
+        index.erase(lru.first);
+        entries.pop_back();
+        ++statistics.evictions;
+    }
+    statistics.entries = entries.size();
+}
+
+void RasterCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ++generation;
+    index.clear();
+    entries.clear();
+    statistics.entries = 0;
+    statistics.bytes = 0;
+}
+
+uint64_t RasterCache::get_generation() const noexcept {
+    return generation;
+}
+
+void RasterCache::set_memory_budget(const size_t _memory_budget) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    memory_budget = _memory_budget;
+    evict(memory_budget);
+}
+
+size_t RasterCache::get_memory_budget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memory_budget;
+}
+
+RasterCacheStatistics RasterCache::get_statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
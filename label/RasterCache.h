@@ -0,0 +1,137 @@
+#ifndef LABEL_PRINTER_DRIVER_RASTERCACHE_H
+#define LABEL_PRINTER_DRIVER_RASTERCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cairo/cairo.h>
+
+#include "Label.h"
+#include "ProductLabel.h"
+#include "GlyphAtlas.h"
+
+/**
+ * Everything that affects printing data of a `ProductLabel`. Dates are stored
+ * already formatted, so labels printed within the same minute (or whatever the
+ * precision of the configured date format is) have the same key.
+ */
+struct RasterCacheKey {
+    std::string name;
+    ProductUsage usage {};
+    LabelFormat format {};
+
+    std::string start_date;
+    std::string ready_date;  /**< Empty if the label doesn't have a ready date */
+    std::string discard_date;
+
+    uint8_t threshold {};
+    cairo_format_t surface_format {};
+    TextEngine text_engine {};
+
+    bool operator==(const RasterCacheKey& other) const noexcept;
+};
+
+struct RasterCacheKeyHash {
+    size_t operator()(const RasterCacheKey& key) const noexcept;
+};
+
+/**
+ * Counters of a `RasterCache`.
+ */
+struct RasterCacheStatistics {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    size_t entries = 0;
+    size_t bytes = 0;  /**< Memory taken by cached printing data */
+};
+
+/**
+ * Least recently used cache of finished printing data.
+ *
+ * Size of the cache is limited by memory taken by the printing data rather than
+ * by the number of entries, because labels of different media differ a lot in size.
+ * All functions are thread safe.
+ *
+ * @see ProductLabelCreator::get_raster_cache()
+ */
+class RasterCache {
+public:
+    using Data = std::shared_ptr<const std::vector<uint8_t>>;
+
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+private:
+    using Entry = std::pair<RasterCacheKey, Data>;
+
+    std::list<Entry> entries;  /**< Most recently used entry is at the front */
+    std::unordered_map<RasterCacheKey, std::list<Entry>::iterator, RasterCacheKeyHash> index;
+
+    size_t memory_budget;
+    RasterCacheStatistics statistics {};
+
+    /**
+     * Incremented by `clear()`. Data rendered before the cache was cleared
+     * (e.g. with the previous config) is not inserted.
+     */
+    std::atomic<uint64_t> generation {0};
+
+    mutable std::mutex mutex;
+
+    void evict(size_t budget);
+
+public:
+    /**
+     * @param memory_budget Maximum number of bytes of cached printing data, `0` disables the cache
+     */
+    explicit RasterCache(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+    /**
+     * Looks up printing data and marks it as the most recently used.
+     *
+     * @return Cached printing data or `nullptr` on miss
+     */
+    [[nodiscard]] Data find(const RasterCacheKey& key);
+
+    /**
+     * Stores printing data, evicting the least recently used entries if the memory
+     * budget would be exceeded. Data bigger than the whole budget is not stored.
+     *
+     * @param key Key of the data
+     * @param data Printing data
+     * @param generation Value of `get_generation()` read before rendering of the data has started
+     */
+    void insert(const RasterCacheKey& key, Data data, uint64_t generation);
+
+    /**
+     * Same as above, but copies the data only if it is actually stored (it isn't when the entry
+     * is already there, data is too big or the cache was cleared in the meantime).
+     */
+    void insert(const RasterCacheKey& key, const std::vector<uint8_t>& data, uint64_t generation);
+
+    /**
+     * Removes all entries. Counters are kept.
+     */
+    void clear();
+
+    [[nodiscard]] uint64_t get_generation() const noexcept;
+
+    /**
+     * Sets the memory budget and evicts entries which no longer fit.
+     *
+     * @param memory_budget Maximum number of bytes of cached printing data, `0` disables the cache
+     */
+    void set_memory_budget(size_t memory_budget);
+    [[nodiscard]] size_t get_memory_budget() const;
+
+    [[nodiscard]] RasterCacheStatistics get_statistics() const;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_RASTERCACHE_H
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RASTER_CONVERTER_X86
+#include <immintrin.h>
+#endif
+
+#include "RasterConverter.h"
+
+namespace {
+    constexpr uint32_t W0 = 77, W1 = 150, W2 = 29;
+
+    inline uint32_t scalar_batch(const unsigned char *pix, const uint32_t count, const uint32_t luma_threshold) noexcept {
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < count; ++i, pix += 4) {
+            const uint32_t luma = pix[0] * W0 + pix[1] * W1 + pix[2] * W2;
+            mask |= static_cast<uint32_t>(luma < luma_threshold) << i;
+        }
+        return mask;
+    }
+
+    uint32_t scalar_kernel(const unsigned char *pix, const uint32_t luma_threshold) {
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < RasterConverter::BLOCK_COLUMNS; i += 8)
+            mask |= scalar_batch(pix + i * 4, 8, luma_threshold) << i;
+        return mask;
+    }
+
+    inline uint32_t scalar_a8_batch(const unsigned char *pix, const uint32_t count, const uint32_t alpha_limit) noexcept {
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < count; ++i)
+            mask |= static_cast<uint32_t>(pix[i] > alpha_limit) << i;
+        return mask;
+    }
+
+    uint32_t scalar_a8_kernel(const unsigned char *pix, const uint32_t alpha_limit) {
+        return scalar_a8_batch(pix, RasterConverter::BLOCK_COLUMNS, alpha_limit);
+    }
+
+    inline uint32_t load_a1_word(const unsigned char *data) noexcept {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        // On big-endian machines the first pixel is in the uppermost bit
+        word = ((word >> 1u) & 0x55555555u) | ((word & 0x55555555u) << 1u);
+        word = ((word >> 2u) & 0x33333333u) | ((word & 0x33333333u) << 2u);
+        word = ((word >> 4u) & 0x0f0f0f0fu) | ((word & 0x0f0f0f0fu) << 4u);
+        word = __builtin_bswap32(word);
+#endif
+        return word;
+    }
+
+#ifdef RASTER_CONVERTER_X86
+    /*
+    Every RGB24 pixel is a 32-bit lane. Its bytes are masked out into separate lanes,
+    multiplied by the weights (products fit in the lower 16 bits) and summed. Lanes
+    are then compared with the threshold and the comparison results narrowed down
+    to bytes, so movemask gives one bit per pixel.
+    */
+    __attribute__((target("sse2")))
+    inline __m128i sse2_luma_less(const unsigned char *pix, const __m128i threshold) noexcept {
+        const __m128i byte_mask = _mm_set1_epi32(0xff);
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix));
+
+        const __m128i p0 = _mm_and_si128(v, byte_mask);
+        const __m128i p1 = _mm_and_si128(_mm_srli_epi32(v, 8), byte_mask);
+        const __m128i p2 = _mm_and_si128(_mm_srli_epi32(v, 16), byte_mask);
+
+        __m128i luma = _mm_mullo_epi16(p0, _mm_set1_epi32(W0));
+        luma = _mm_add_epi32(luma, _mm_mullo_epi16(p1, _mm_set1_epi32(W1)));
+        luma = _mm_add_epi32(luma, _mm_mullo_epi16(p2, _mm_set1_epi32(W2)));
+
+        return _mm_cmplt_epi32(luma, threshold);
+    }
+
+    __attribute__((target("sse2")))
+    uint32_t sse2_kernel(const unsigned char *pix, const uint32_t luma_threshold) {
+        const __m128i threshold = _mm_set1_epi32(static_cast<int>(luma_threshold));
+
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < RasterConverter::BLOCK_COLUMNS; i += 16, pix += 64) {
+            const __m128i a = sse2_luma_less(pix, threshold);
+            const __m128i b = sse2_luma_less(pix + 16, threshold);
+            const __m128i c = sse2_luma_less(pix + 32, threshold);
+            const __m128i d = sse2_luma_less(pix + 48, threshold);
+
+            const __m128i packed = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            mask |= static_cast<uint32_t>(_mm_movemask_epi8(packed)) << i;
+        }
+        return mask;
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i avx2_luma_less(const unsigned char *pix, const __m256i threshold) noexcept {
+        const __m256i byte_mask = _mm256_set1_epi32(0xff);
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pix));
+
+        const __m256i p0 = _mm256_and_si256(v, byte_mask);
+        const __m256i p1 = _mm256_and_si256(_mm256_srli_epi32(v, 8), byte_mask);
+        const __m256i p2 = _mm256_and_si256(_mm256_srli_epi32(v, 16), byte_mask);
+
+        __m256i luma = _mm256_mullo_epi16(p0, _mm256_set1_epi32(W0));
+        luma = _mm256_add_epi32(luma, _mm256_mullo_epi16(p1, _mm256_set1_epi32(W1)));
+        luma = _mm256_add_epi32(luma, _mm256_mullo_epi16(p2, _mm256_set1_epi32(W2)));
+
+        return _mm256_cmpgt_epi32(threshold, luma);
+    }
+
+    __attribute__((target("avx2")))
+    uint32_t avx2_kernel(const unsigned char *pix, const uint32_t luma_threshold) {
+        const __m256i threshold = _mm256_set1_epi32(static_cast<int>(luma_threshold));
+
+        const __m256i a = avx2_luma_less(pix, threshold);
+        const __m256i b = avx2_luma_less(pix + 32, threshold);
+        const __m256i c = avx2_luma_less(pix + 64, threshold);
+        const __m256i d = avx2_luma_less(pix + 96, threshold);
+
+        // Packing works within 128-bit lanes, so groups of 4 pixels have to be put back in order
+        const __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        const __m256i ordered = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(ordered));
+    }
+
+    /*
+    A8 pixels are compared as unsigned bytes - saturated subtraction of the limit
+    is zero only for pixels which are not black.
+    */
+    __attribute__((target("sse2")))
+    uint32_t sse2_a8_kernel(const unsigned char *pix, const uint32_t alpha_limit) {
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(alpha_limit));
+        const __m128i zero = _mm_setzero_si128();
+
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix + 16));
+        const auto white_a = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(a, limit), zero)));
+        const auto white_b = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(b, limit), zero)));
+
+        return ~(white_a | (white_b << 16u));
+    }
+
+    __attribute__((target("avx2")))
+    uint32_t avx2_a8_kernel(const unsigned char *pix, const uint32_t alpha_limit) {
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(alpha_limit));
+
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pix));
+        const __m256i white = _mm256_cmpeq_epi8(_mm256_subs_epu8(v, limit), _mm256_setzero_si256());
+
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(white));
+    }
+#endif
+}
+
+RasterConverter::SimdLevel RasterConverter::detect_simd_level() noexcept {
+#ifdef RASTER_CONVERTER_X86
+    if(__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+RasterConverter::RowKernel RasterConverter::select_kernel(const SimdLevel level) noexcept {
+    const SimdLevel supported = std::min(level, detect_simd_level());
+
+    switch(supported) {
+#ifdef RASTER_CONVERTER_X86
+        case SimdLevel::AVX2: return avx2_kernel;
+        case SimdLevel::SSE2: return sse2_kernel;
+#endif
+        default: return scalar_kernel;
+    }
+}
+
+RasterConverter::RowKernel RasterConverter::select_a8_kernel(const SimdLevel level) noexcept {
+    const SimdLevel supported = std::min(level, detect_simd_level());
+
+    switch(supported) {
+#ifdef RASTER_CONVERTER_X86
+        case SimdLevel::AVX2: return avx2_a8_kernel;
+        case SimdLevel::SSE2: return sse2_a8_kernel;
+#endif
+        default: return scalar_a8_kernel;
+    }
+}
+
+template<typename RowMask>
+void RasterConverter::convert_blocks(const uint32_t width, const uint32_t height, uint8_t *out, RowMask&& row_mask) {
+    if(height > MAX_HEIGHT)
+        throw std::invalid_argument("Label is too high to fit in a single raster line");
+
+    for(uint32_t col = 0; col < width; col += BLOCK_COLUMNS) {
+        const uint32_t block_width = std::min(BLOCK_COLUMNS, width - col);
+        write_packet_headers(out, col, block_width);
+
+        uint8_t *block_out = out + col * PACKET_SIZE + COMMAND_SIZE;
+
+        // Walk the block in bands of 8 rows - every band gives one octet of each column
+        for(uint32_t row = 0; row < height; row += 8) {
+            const uint32_t band_height = std::min(8u, height - row);
+            uint32_t masks[8] {};
+
+            for(uint32_t k = 0; k < band_height; ++k)
+                masks[k] = row_mask(row + k, col, block_width);
+
+            transpose_masks(masks, block_width, block_out + row / 8);
+        }
+    }
+}
+
+void RasterConverter::rgb24_to_columns(const unsigned char *data, const int stride, const uint32_t width,
+        const uint32_t height, uint8_t *out, const uint8_t threshold) {
+    static const SimdLevel detected = detect_simd_level();
+    rgb24_to_columns(data, stride, width, height, out, threshold, detected);
+}
+
+void RasterConverter::rgb24_to_columns(const unsigned char *data, const int stride, const uint32_t width,
+        const uint32_t height, uint8_t *out, const uint8_t threshold, const SimdLevel level) {
+    const RowKernel kernel = select_kernel(level);
+    const uint32_t luma_threshold = static_cast<uint32_t>(threshold) << 8u;
+
+    convert_blocks(width, height, out, [&](const uint32_t row, const uint32_t col, const uint32_t block_width) {
+        const unsigned char *pix = data + static_cast<size_t>(row) * stride + col * 4;
+        return block_width == BLOCK_COLUMNS ?
+                kernel(pix, luma_threshold) : scalar_batch(pix, block_width, luma_threshold);
+    });
+}
+
+void RasterConverter::a8_to_columns(const unsigned char *data, const int stride, const uint32_t width,
+        const uint32_t height, uint8_t *out, const uint8_t threshold) {
+    static const SimdLevel detected = detect_simd_level();
+    a8_to_columns(data, stride, width, height, out, threshold, detected);
+}
+
+void RasterConverter::a8_to_columns(const unsigned char *data, const int stride, const uint32_t width,
+        const uint32_t height, uint8_t *out, const uint8_t threshold, const SimdLevel level) {
+    const RowKernel kernel = select_a8_kernel(level);
+    const uint32_t alpha_limit = 255u - threshold;
+
+    convert_blocks(width, height, out, [&](const uint32_t row, const uint32_t col, const uint32_t block_width) {
+        const unsigned char *pix = data + static_cast<size_t>(row) * stride + col;
+        return block_width == BLOCK_COLUMNS ?
+                kernel(pix, alpha_limit) : scalar_a8_batch(pix, block_width, alpha_limit);
+    });
+}
+
+void RasterConverter::a1_to_columns(const unsigned char *data, const int stride, const uint32_t width,
+        const uint32_t height, uint8_t *out) {
+    // Blocks are 32 columns wide, so every block row is exactly one 32-bit word of the image
+    convert_blocks(width, height, out, [&](const uint32_t row, const uint32_t col, const uint32_t block_width) {
+        const uint32_t word = load_a1_word(data + static_cast<size_t>(row) * stride + col / 8);
+        return block_width == BLOCK_COLUMNS ? word : word & ((1u << block_width) - 1u);
+    });
+}
+
+inline void RasterConverter::write_packet_headers(uint8_t *out, const uint32_t first_column, const uint32_t columns) noexcept {
+    uint8_t *packet = out + first_column * PACKET_SIZE;
+    for(uint32_t i = 0; i < columns; ++i, packet += PACKET_SIZE) {
+        packet[0] = 0x67;
+        packet[1] = 0x00;
+        packet[2] = 0x5a;
+        std::fill(packet + COMMAND_SIZE, packet + PACKET_SIZE, 0x00);
+    }
+}
+
+inline void RasterConverter::transpose_masks(const uint32_t masks[8], const uint32_t columns, uint8_t *out) noexcept {
+    for(uint32_t group = 0; group < columns; group += 8) {
+        /*
+        Put byte of each row mask into 8x8 bit matrix (first row goes to the last byte,
+        because pixels are packed starting from MSB) and transpose it, so that
+        byte `i` holds the octet of column `i`.
+        */
+        uint64_t x = 0;
+        for(uint32_t k = 0; k < 8; ++k)
+            x |= static_cast<uint64_t>((masks[k] >> group) & 0xffu) << (8 * (7 - k));
+
+        uint64_t t;
+        t = (x ^ (x >> 7u)) & 0x00aa00aa00aa00aaULL;
+        x = x ^ t ^ (t << 7u);
+        t = (x ^ (x >> 14u)) & 0x0000cccc0000ccccULL;
+        x = x ^ t ^ (t << 14u);
+        t = (x ^ (x >> 28u)) & 0x00000000f0f0f0f0ULL;
+        x = x ^ t ^ (t << 28u);
+
+        const uint32_t group_columns = std::min(8u, columns - group);
+        uint8_t *octet = out + group * PACKET_SIZE;
+        for(uint32_t i = 0; i < group_columns; ++i, octet += PACKET_SIZE)
+            *octet = static_cast<uint8_t>(x >> (8 * i));
+    }
+}
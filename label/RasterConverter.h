@@ -0,0 +1,124 @@
+#ifndef LABEL_PRINTER_DRIVER_RASTERCONVERTER_H
+#define LABEL_PRINTER_DRIVER_RASTERCONVERTER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Converts rendered label images into printing data.
+ *
+ * Label images are stored row by row, but the printer expects them column by
+ * column (each column is one raster line). Reading the image column by column
+ * jumps a whole stride for every pixel, so the conversion is done in blocks of
+ * `BLOCK_COLUMNS` columns: every row of a block is one contiguous read and all
+ * output packets of the block stay hot while the block is walked from top to bottom.
+ *
+ * Each row of a block is thresholded into a bit mask by a row kernel (scalar, SSE2
+ * or AVX2 - chosen at runtime) and every 8 masks are then transposed into one
+ * octet of each column. Besides RGB24, alpha-only A8 and A1 images are supported -
+ * A1 rows already are bit masks, so they are only transposed.
+ *
+ * @see Label::get_printing_data()
+ */
+class RasterConverter {
+public:
+    static constexpr size_t COMMAND_SIZE = 3;   /**< Size of print data command (`0x67 0x00 0x5a`) */
+    static constexpr size_t RASTER_SIZE = 90;   /**< Size of raster data of a single column */
+    static constexpr size_t PACKET_SIZE = COMMAND_SIZE + RASTER_SIZE;
+    static constexpr uint32_t MAX_HEIGHT = RASTER_SIZE * 8;
+
+    /**
+     * Number of columns converted at once. 32 RGB24 pixels take two 64 bytes cache lines
+     * and are a single batch of the AVX2 kernel.
+     */
+    static constexpr uint32_t BLOCK_COLUMNS = 32;
+
+    /**
+     * Row kernels available for thresholding. Scalar kernel handles 8 pixels,
+     * SSE2 16 pixels and AVX2 32 pixels per batch.
+     */
+    enum class SimdLevel {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @return The best row kernel supported by the CPU
+     */
+    [[nodiscard]] static SimdLevel detect_simd_level() noexcept;
+
+    /**
+     * Converts RGB24 image into column packets.
+     *
+     * `out` must point to at least `width * PACKET_SIZE` bytes. Output is the same
+     * as described in `Label::get_printing_data()`. A pixel is black if its luma
+     * (computed in 8.8 fixed point) is lower than `threshold`.
+     *
+     * @param data Image data in RGB24 format
+     * @param stride Number of bytes per image row
+     * @param width Image width in pixels (number of columns/packets)
+     * @param height Image height in pixels
+     * @param out Destination buffer
+     * @param threshold Black/white threshold
+     *
+     * @throws std::invalid_argument if `height` doesn't fit in a single packet
+     */
+    static void rgb24_to_columns(const unsigned char *data, int stride, uint32_t width, uint32_t height, uint8_t *out,
+            uint8_t threshold);
+
+    /**
+     * Same as above, but uses given row kernel instead of the detected one. If the CPU
+     * doesn't support `level`, the best supported kernel is used instead.
+     *
+     * All kernels give bit for bit the same output - this overload exists for
+     * benchmarking and verification of that.
+     */
+    static void rgb24_to_columns(const unsigned char *data, int stride, uint32_t width, uint32_t height, uint8_t *out,
+            uint8_t threshold, SimdLevel level);
+
+    /**
+     * Converts A8 image (ink coverage only) into column packets.
+     *
+     * Coverage `a` is treated as gray level `255 - a` (black ink on white background),
+     * so a pixel is black if `255 - a` is lower than `threshold`.
+     *
+     * @see rgb24_to_columns()
+     */
+    static void a8_to_columns(const unsigned char *data, int stride, uint32_t width, uint32_t height, uint8_t *out,
+            uint8_t threshold);
+
+    /**
+     * Same as above, but uses given row kernel instead of the detected one.
+     *
+     * @see rgb24_to_columns(const unsigned char*, int, uint32_t, uint32_t, uint8_t*, uint8_t, SimdLevel)
+     */
+    static void a8_to_columns(const unsigned char *data, int stride, uint32_t width, uint32_t height, uint8_t *out,
+            uint8_t threshold, SimdLevel level);
+
+    /**
+     * Converts A1 image (ink coverage only) into column packets. Every set pixel is black.
+     *
+     * @see rgb24_to_columns()
+     */
+    static void a1_to_columns(const unsigned char *data, int stride, uint32_t width, uint32_t height, uint8_t *out);
+
+private:
+    using RowKernel = uint32_t (*)(const unsigned char *pix, uint32_t threshold);
+
+    [[nodiscard]] static RowKernel select_kernel(SimdLevel level) noexcept;
+    [[nodiscard]] static RowKernel select_a8_kernel(SimdLevel level) noexcept;
+
+    /**
+     * Common part of all conversions - walks the image block by block and asks
+     * `row_mask(row, column, block_width)` for bit masks of the block rows.
+     */
+    template<typename RowMask>
+    static void convert_blocks(uint32_t width, uint32_t height, uint8_t *out, RowMask&& row_mask);
+
+    static inline void write_packet_headers(uint8_t *out, uint32_t first_column, uint32_t columns) noexcept;
+    static inline void transpose_masks(const uint32_t masks[8], uint32_t columns, uint8_t *out) noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_RASTERCONVERTER_H
@@ -5,10 +5,17 @@
 #include "printer/PrinterStatus.h"
 #include "label/Label.h"
 #include "label/ProductLabelCreator.h"
+#include "utils/Logger.h"
+#include "utils/Tracer.h"
 
 using std::cout, std::endl;
 
+/*
+Set LABEL_PRINTER_TRACE=<file> to write a Chrome trace of the session (see `Tracer`).
+*/
 int main() {
+    Tracer::start_from_environment();
+
     Printer printer = Printer();
     printer.scan_for_printer();
     cout << endl;
@@ -19,26 +26,27 @@ int main() {
     status.display();
 
     Label::set_continuous_length_label_type(LabelSubtypes::ContinuousLength::CL_29, 40);
-    Label *label = new ProductLabel("Ketchup", ProductUsage::BOARD, {}, "2h", "4h");
+    ProductLabel label("Ketchup", ProductUsage::BOARD, {}, "2h", "4h");
 
     ProductLabelCreator::load_config("../label/label_conf.yml");
 
     // Save printed page
-    auto *png = dynamic_cast<ProductLabel*>(label);
-    ProductLabelCreator::export_to_png(*png, "out.png");
+    ProductLabelCreator::export_to_png(label, "out.png");
 
     PrinterJobData job_data {};
     job_data.set_quality(true);
     job_data.set_cut_at_end(true);
 
-    std::vector<Label*> labels = {label};
+    std::vector<Label*> labels = {&label};
 
     char choice;
+    Logger::flush();  // Log messages come from another thread, they shouldn't get mixed with the prompt
     cout << "Print test page? [y/n]: ";
     std::cin >> choice;
     if(choice == 'y') {
         printer.print(labels, job_data);
     }
 
+    Tracer::stop();
     return 0;
 }
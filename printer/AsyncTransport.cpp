@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "AsyncTransport.h"
+#include "../exceptions/USBError.h"
+#include "../utils/Metrics.h"
+#include "../utils/Tracer.h"
+
+namespace {
+    constexpr size_t DEVICE_MEMORY_GRANULARITY = 64 * 1024;
+}
+
+AsyncTransport::AsyncTransport(libusb_context *_ctx, libusb_device_handle *_handle, const uint8_t _endpoint,
+        const size_t max_in_flight, BufferPool *_buffers, const unsigned _timeout_ms)
+    : ctx(_ctx),
+    handle(_handle),
+    endpoint(_endpoint),
+    timeout_ms(_timeout_ms),
+    buffers(_buffers),
+    slots(max_in_flight),
+    running(true) {
+    if(max_in_flight < 2)
+        throw std::invalid_argument("At least 2 transfers must be allowed in flight");
+
+    for(auto& slot: slots) {
+        slot.owner = this;
+        slot.transfer = libusb_alloc_transfer(0);
+        if(slot.transfer == nullptr) {
+            for(auto& allocated: slots)
+                libusb_free_transfer(allocated.transfer);
+            throw USBError(libusb_error_name(LIBUSB_ERROR_NO_MEM), "allocating transfer");
+        }
+    }
+
+    event_thread = std::thread(&AsyncTransport::handle_events, this);
+}
+
+AsyncTransport::~AsyncTransport() noexcept {
+    // Transfers can be submitted without a timeout, so ones still pending (the caller unwinds on an exception
+    // instead of calling `wait_all()`) might never complete. The event thread runs their callbacks.
+    cancel();
+    {
+        std::unique_lock lock(mutex);
+        transfer_done.wait(lock, [this] { return in_flight == 0; });
+    }
+
+    running = false;
+    event_thread.join();
+
+    for(auto& slot: slots) {
+        libusb_free_transfer(slot.transfer);
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000105
+        if(slot.device_memory != nullptr)
+            libusb_dev_mem_free(handle, slot.device_memory, slot.device_memory_size);
+#endif
+        recycle(std::move(slot.buffer));
+    }
+}
+
+void AsyncTransport::handle_events() noexcept {
+    timeval timeout {0, 100000};
+    while(running)
+        libusb_handle_events_timeout_completed(ctx, &timeout, nullptr);
+}
+
+void LIBUSB_CALL AsyncTransport::on_transfer_completed(libusb_transfer *transfer) noexcept {
+    auto *slot = static_cast<Slot*>(transfer->user_data);
+    AsyncTransport *self = slot->owner;
+
+    const auto completed = std::chrono::steady_clock::now();
+    Tracer::record_async("bulk_transfer", "usb", static_cast<uint64_t>(slot - self->slots.data()), slot->submitted, completed,
+            "bytes", transfer->actual_length);
+
+    if(transfer->status == LIBUSB_TRANSFER_COMPLETED && transfer->actual_length == transfer->length) {
+        Metrics::record(PrintStage::USB_SEND, completed - slot->submitted);
+        Metrics::increment(PrintCounter::BYTES_SENT, transfer->actual_length);
+    }
+    else if(transfer->status != LIBUSB_TRANSFER_CANCELLED)
+        Metrics::increment(PrintCounter::TRANSFER_ERRORS);
+
+    {
+        std::lock_guard lock(self->mutex);
+        if(!self->error) {
+            if(transfer->status != LIBUSB_TRANSFER_COMPLETED)
+                self->error = transfer_status_name(transfer->status);
+            else if(transfer->actual_length != transfer->length)
+                self->error = "short transfer";
+        }
+
+        slot->busy = false;
+        --self->in_flight;
+    }
+    self->transfer_done.notify_all();
+}
+
+std::string AsyncTransport::transfer_status_name(const libusb_transfer_status status) noexcept {
+    switch(status) {
+        case LIBUSB_TRANSFER_COMPLETED: return "LIBUSB_TRANSFER_COMPLETED";
+        case LIBUSB_TRANSFER_ERROR:     return "LIBUSB_TRANSFER_ERROR";
+        case LIBUSB_TRANSFER_TIMED_OUT: return "LIBUSB_TRANSFER_TIMED_OUT";
+        case LIBUSB_TRANSFER_CANCELLED: return "LIBUSB_TRANSFER_CANCELLED";
+        case LIBUSB_TRANSFER_STALL:     return "LIBUSB_TRANSFER_STALL";
+        case LIBUSB_TRANSFER_NO_DEVICE: return "LIBUSB_TRANSFER_NO_DEVICE";
+        case LIBUSB_TRANSFER_OVERFLOW:  return "LIBUSB_TRANSFER_OVERFLOW";
+        default:                        return "UNKNOWN";
+    }
+}
+
+void AsyncTransport::throw_if_failed() {
+    if(error) {
+        std::string what = error.value();
+        error.reset();
+        throw USBError(what, "asynchronous transfer");
+    }
+}
+
+void AsyncTransport::submit(std::vector<uint8_t> data) {
+    std::unique_lock lock(mutex);
+    transfer_done.wait(lock, [this] { return in_flight < slots.size() || error; });
+    throw_if_failed();
+
+    Slot& slot = *std::find_if(slots.begin(), slots.end(), [](const Slot& s) { return !s.busy; });
+    const int length = static_cast<int>(data.size());
+    unsigned char *buffer = stage(slot, data);
+    libusb_fill_bulk_transfer(slot.transfer, handle, endpoint, buffer, length, on_transfer_completed, &slot,
+            timeout_ms);
+
+    slot.submitted = std::chrono::steady_clock::now();
+    const int ret = libusb_submit_transfer(slot.transfer);
+    if(ret < LIBUSB_SUCCESS) {
+        Metrics::increment(PrintCounter::TRANSFER_ERRORS);
+        throw USBError(libusb_error_name(ret), "submitting transfer");
+    }
+
+    slot.busy = true;
+    ++in_flight;
+}
+
+unsigned char *AsyncTransport::stage(Slot& slot, std::vector<uint8_t>& data) {
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000105
+    if(device_memory_supported && data.size() > slot.device_memory_size) {
+        if(slot.device_memory != nullptr)
+            libusb_dev_mem_free(handle, slot.device_memory, slot.device_memory_size);
+
+        const size_t size = (data.size() + DEVICE_MEMORY_GRANULARITY - 1) / DEVICE_MEMORY_GRANULARITY * DEVICE_MEMORY_GRANULARITY;
+        slot.device_memory = libusb_dev_mem_alloc(handle, size);
+        slot.device_memory_size = slot.device_memory != nullptr ? size : 0;
+
+        // Not supported by the platform (or the device), don't try again
+        device_memory_supported = slot.device_memory != nullptr;
+    }
+
+    if(slot.device_memory != nullptr && data.size() <= slot.device_memory_size) {
+        std::copy(data.begin(), data.end(), slot.device_memory);
+        recycle(std::move(data));
+        return slot.device_memory;
+    }
+#endif
+
+    recycle(std::move(slot.buffer));
+    slot.buffer = std::move(data);
+    return slot.buffer.data();
+}
+
+void AsyncTransport::recycle(std::vector<uint8_t> buffer) noexcept {
+    if(buffers != nullptr)
+        buffers->release(std::move(buffer));
+}
+
+void AsyncTransport::wait_all() {
+    std::unique_lock lock(mutex);
+    transfer_done.wait(lock, [this] { return in_flight == 0; });
+    throw_if_failed();
+}
+
+void AsyncTransport::cancel() noexcept {
+    std::lock_guard lock(mutex);
+    for(auto& slot: slots) {
+        if(slot.busy)
+            libusb_cancel_transfer(slot.transfer);
+    }
+}
+
+size_t AsyncTransport::pending() noexcept {
+    std::lock_guard lock(mutex);
+    return in_flight;
+}
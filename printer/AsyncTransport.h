@@ -0,0 +1,127 @@
+#ifndef LABEL_PRINTER_DRIVER_ASYNCTRANSPORT_H
+#define LABEL_PRINTER_DRIVER_ASYNCTRANSPORT_H
+
+#include <libusb-1.0/libusb.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/BufferPool.h"
+
+/**
+ * Asynchronous bulk OUT transport built on `libusb_submit_transfer`.
+ *
+ * Submitted buffers are owned by the transport until their transfer completes,
+ * so the caller can go on (for example render the next page) while the data is
+ * being sent. Events are handled by a separate thread. At most `max_in_flight`
+ * transfers are pending at once - `submit()` blocks when all of them are in use.
+ *
+ * Transfers are completed in order of submission, because they all go to the same endpoint.
+ *
+ * Where libusb supports it, data is copied into device memory (`libusb_dev_mem_alloc`), which
+ * the kernel can transfer without another copy. Each transfer keeps its device memory from
+ * submission to submission. Submitted vectors are then returned to the buffer pool right away.
+ */
+class AsyncTransport {
+private:
+    struct Slot {
+        AsyncTransport *owner = nullptr;
+        libusb_transfer *transfer = nullptr;
+        std::vector<uint8_t> buffer {};
+        unsigned char *device_memory = nullptr;
+        size_t device_memory_size = 0;
+        bool busy = false;
+        std::chrono::steady_clock::time_point submitted {};
+    };
+
+    libusb_context *ctx;
+    libusb_device_handle *handle;
+    const uint8_t endpoint;
+    const unsigned timeout_ms;
+    BufferPool *buffers;
+    bool device_memory_supported = true;
+
+    std::vector<Slot> slots;
+    size_t in_flight = 0;
+    std::optional<std::string> error;
+
+    std::mutex mutex;
+    std::condition_variable transfer_done;
+
+    std::atomic<bool> running;
+    std::thread event_thread;
+
+    void handle_events() noexcept;
+    static void LIBUSB_CALL on_transfer_completed(libusb_transfer *transfer) noexcept;
+    static std::string transfer_status_name(libusb_transfer_status status) noexcept;
+
+    void throw_if_failed();
+
+    /**
+     * Hands `data` over to the slot.
+     *
+     * @return Buffer which should be transferred
+     */
+    unsigned char *stage(Slot& slot, std::vector<uint8_t>& data);
+    void recycle(std::vector<uint8_t> buffer) noexcept;
+
+public:
+    static constexpr size_t DEFAULT_MAX_IN_FLIGHT = 4;
+
+    /**
+     * Allocates transfers and starts event handling thread.
+     *
+     * @param ctx Libusb context of `handle`
+     * @param handle Opened device
+     * @param endpoint Bulk OUT endpoint
+     * @param max_in_flight Maximal number of pending transfers (at least 2)
+     * @param buffers Pool to which sent buffers are returned (can be null)
+     * @param timeout_ms Maximal time of each transfer, 0 for no limit - a transfer which times out fails
+     *
+     * @throws std::invalid_argument if `max_in_flight` is lower than 2
+     * @throws USBError if transfers can't be allocated
+     */
+    AsyncTransport(libusb_context *ctx, libusb_device_handle *handle, uint8_t endpoint,
+            size_t max_in_flight = DEFAULT_MAX_IN_FLIGHT, BufferPool *buffers = nullptr, unsigned timeout_ms = 0);
+
+    /**
+     * Cancels pending transfers and waits until their callbacks run (errors are ignored), stops event
+     * thread and frees transfers. Kept buffers are returned to the pool.
+     */
+    ~AsyncTransport() noexcept;
+
+    AsyncTransport(const AsyncTransport&) = delete;
+    AsyncTransport& operator=(const AsyncTransport&) = delete;
+
+    /**
+     * Submits `data` for transfer. Blocks if `max_in_flight` transfers are already pending.
+     *
+     * @param data Data to send, moved into the transport
+     *
+     * @throws USBError if submitting fails or if any of previous transfers failed
+     */
+    void submit(std::vector<uint8_t> data);
+
+    /**
+     * Blocks until all pending transfers are completed.
+     *
+     * @throws USBError if any of the transfers failed
+     */
+    void wait_all();
+
+    /**
+     * Cancels all pending transfers (for example when the printer reports an error and
+     * won't take more data). Cancelled transfers are reported as failed by `wait_all()`.
+     */
+    void cancel() noexcept;
+
+    [[nodiscard]] size_t pending() noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_ASYNCTRANSPORT_H
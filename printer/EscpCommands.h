@@ -0,0 +1,135 @@
+#ifndef LABEL_PRINTER_DRIVER_ESCPCOMMANDS_H
+#define LABEL_PRINTER_DRIVER_ESCPCOMMANDS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../label/Label.h"
+
+/**
+ * Raster commands of QL printers, built at compile time where their arguments are known.
+ */
+class EscpCommands {
+public:
+    static constexpr uint8_t PRINT = 0x0c;
+    static constexpr uint8_t PRINT_WITH_FEEDING = 0x1a;  /**< Print command of the last page */
+
+    /**
+     * Offset of the starting page byte in `print_information()`, the only byte of job data which differs between pages.
+     */
+    static constexpr size_t STARTING_PAGE_OFFSET = 11;
+
+    [[nodiscard]] static constexpr std::array<uint8_t, 13> print_information(const bool high_quality,
+            const LabelType type, const uint8_t height_mm, const uint8_t width_mm, const uint32_t raster_number,
+            const bool starting_page) noexcept {
+        return {
+            0x1b, 0x69, 0x7a,
+            static_cast<uint8_t>(high_quality ? 0xce : 0x8e),
+            static_cast<uint8_t>(type == LabelType::DIE_CUT ? 0x0b : 0x0a),
+            height_mm, width_mm,
+            static_cast<uint8_t>(raster_number & 0xffu),
+            static_cast<uint8_t>((raster_number >> 8u) & 0xffu),
+            static_cast<uint8_t>((raster_number >> 16u) & 0xffu),
+            static_cast<uint8_t>((raster_number >> 24u) & 0xffu),
+            static_cast<uint8_t>(starting_page ? 0x00 : 0x01),
+            0x00
+        };
+    }
+
+    /**
+     * Various mode setting (auto cut).
+     */
+    [[nodiscard]] static constexpr std::array<uint8_t, 4> various_mode(const bool auto_cut) noexcept {
+        return {0x1b, 0x69, 0x4d, static_cast<uint8_t>(auto_cut ? 0x40 : 0x00)};
+    }
+
+    [[nodiscard]] static constexpr std::array<uint8_t, 4> cut_every(const uint8_t labels) noexcept {
+        return {0x1b, 0x69, 0x41, labels};
+    }
+
+    /**
+     * Expanded mode setting (cut at end).
+     */
+    [[nodiscard]] static constexpr std::array<uint8_t, 4> expanded_mode(const bool cut_at_end) noexcept {
+        return {0x1b, 0x69, 0x4b, static_cast<uint8_t>(cut_at_end ? 0x08 : 0x00)};
+    }
+
+    /**
+     * @param dots Margin in pixels (points)
+     */
+    [[nodiscard]] static constexpr std::array<uint8_t, 5> margin_amount(const uint16_t dots) noexcept {
+        return {0x1b, 0x69, 0x64, static_cast<uint8_t>(dots & 0xffu), static_cast<uint8_t>((dots >> 8u) & 0xffu)};
+    }
+
+    /**
+     * Enables compressed (PackBits) raster lines.
+     */
+    [[nodiscard]] static constexpr std::array<uint8_t, 2> compression_mode() noexcept {
+        return {0x4d, 0x02};
+    }
+
+    [[nodiscard]] static constexpr uint8_t print_command(const bool last_page) noexcept {
+        return last_page ? PRINT_WITH_FEEDING : PRINT;
+    }
+};
+
+/**
+ * Fixed-capacity buffer which commands are appended to, usable in constant expressions.
+ */
+template<size_t Capacity>
+class CommandBuffer {
+private:
+    std::array<uint8_t, Capacity> bytes {};
+    size_t length = 0;
+
+public:
+    /**
+     * @throws std::length_error if the command doesn't fit (a compile error in constant expressions)
+     */
+    template<size_t N>
+    constexpr CommandBuffer& append(const std::array<uint8_t, N>& command) {
+        if(length + N > Capacity)
+            throw std::length_error("Command doesn't fit in the command buffer");
+        for(size_t i = 0; i < N; ++i)
+            bytes[length++] = command[i];
+        return *this;
+    }
+
+    constexpr uint8_t& operator[](const size_t i) noexcept { return bytes[i]; }
+    constexpr const uint8_t& operator[](const size_t i) const noexcept { return bytes[i]; }
+
+    [[nodiscard]] constexpr const uint8_t *data() const noexcept { return bytes.data(); }
+    [[nodiscard]] constexpr size_t size() const noexcept { return length; }
+};
+
+/**
+ * Job data sent in front of each page of a job (see `PrinterJobData::construct_job_header()`). It is built
+ * once per job - only the starting page flag differs between pages and it is patched in place.
+ */
+class JobHeader {
+public:
+    /** Print information, 3 filler bytes and all of the optional settings */
+    static constexpr size_t CAPACITY = 13 + 3 + 4 + 4 + 4 + 5 + 2;
+
+private:
+    CommandBuffer<CAPACITY> buffer;
+
+public:
+    /**
+     * @param buffer Commands of the job, starting with `EscpCommands::print_information()`
+     */
+    constexpr explicit JobHeader(const CommandBuffer<CAPACITY>& _buffer) noexcept
+        : buffer(_buffer) {}
+
+    constexpr void set_starting_page(const bool starting_page) noexcept {
+        buffer[EscpCommands::STARTING_PAGE_OFFSET] = starting_page ? 0x00 : 0x01;
+    }
+
+    [[nodiscard]] constexpr const uint8_t *data() const noexcept { return buffer.data(); }
+    [[nodiscard]] constexpr size_t size() const noexcept { return buffer.size(); }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_ESCPCOMMANDS_H
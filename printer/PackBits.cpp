@@ -0,0 +1,53 @@
+#include <stdexcept>
+
+#include "PackBits.h"
+
+void PackBits::encode(const uint8_t *data, const size_t size, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while(i < size) {
+        size_t run = 1;
+        while(i + run < size && run < MAX_RUN && data[i + run] == data[i])
+            ++run;
+
+        if(run > 1) {
+            out.push_back(static_cast<uint8_t>(1 - static_cast<int>(run)));
+            out.push_back(data[i]);
+            i += run;
+            continue;
+        }
+
+        // Gather literal bytes until the next run of at least 3 bytes begins (shorter runs don't pay off)
+        const size_t start = i;
+        while(i < size && i - start < MAX_RUN && !(i + 2 < size && data[i] == data[i + 1] && data[i] == data[i + 2]))
+            ++i;
+
+        out.push_back(static_cast<uint8_t>(i - start - 1));
+        out.insert(out.end(), data + start, data + i);
+    }
+}
+
+std::vector<uint8_t> PackBits::compress_printing_data(const std::vector<uint8_t>& printing_data) {
+    std::vector<uint8_t> compressed {};
+    compress_printing_data(printing_data, compressed);
+    return compressed;
+}
+
+void PackBits::compress_printing_data(const std::vector<uint8_t>& printing_data, std::vector<uint8_t>& compressed) {
+    compressed.clear();
+    append_compressed_printing_data(printing_data, compressed);
+}
+
+void PackBits::append_compressed_printing_data(const std::vector<uint8_t>& printing_data, std::vector<uint8_t>& out) {
+    if(printing_data.size() % RasterConverter::PACKET_SIZE != 0)
+        throw std::invalid_argument("Printing data doesn't consist of whole raster packets");
+
+    out.reserve(out.size() + compressed_bound(printing_data.size()));
+
+    for(size_t i = 0; i < printing_data.size(); i += RasterConverter::PACKET_SIZE) {
+        const size_t header = out.size();
+        out.insert(out.end(), {0x67, 0x00, 0x00});
+
+        encode(printing_data.data() + i + RasterConverter::COMMAND_SIZE, RasterConverter::RASTER_SIZE, out);
+        out[header + 2] = static_cast<uint8_t>(out.size() - header - RasterConverter::COMMAND_SIZE);
+    }
+}
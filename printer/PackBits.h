@@ -0,0 +1,69 @@
+#ifndef LABEL_PRINTER_DRIVER_PACKBITS_H
+#define LABEL_PRINTER_DRIVER_PACKBITS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "../label/RasterConverter.h"
+
+/**
+ * PackBits (TIFF) compression of raster data.
+ *
+ * Printer accepts compressed raster lines after compression mode is enabled
+ * in job data (`PrinterJobData::set_compression(bool)`).
+ */
+class PackBits {
+public:
+    static constexpr size_t MAX_RUN = 128;
+
+    /**
+     * Encodes `size` bytes of `data` and appends the result to `out`.
+     *
+     * Runs of 2 or more identical bytes are stored as a header byte `1 - n`
+     * followed by the repeated byte, other bytes are stored as a header byte
+     * `n - 1` followed by `n` literal bytes.
+     *
+     * @param data Bytes to encode
+     * @param size Number of bytes to encode
+     * @param out Vector to which the encoded bytes are appended
+     */
+    static void encode(const uint8_t *data, size_t size, std::vector<uint8_t>& out);
+
+    /**
+     * Compresses printing data (as returned from `Label::get_printing_data()`).
+     *
+     * Each 93 bytes packet with print data command (`0x67 0x00 0x5a`) is replaced with
+     * a packet in which the raster data is compressed and the third byte of the
+     * command holds the compressed size.
+     *
+     * @param printing_data Uncompressed printing data
+     * @return Compressed printing data
+     *
+     * @throws std::invalid_argument if `printing_data` doesn't consist of whole raster packets
+     */
+    [[nodiscard]] static std::vector<uint8_t> compress_printing_data(const std::vector<uint8_t>& printing_data);
+
+    /**
+     * Same as above, but writes compressed data into `compressed` (its contents are replaced),
+     * which doesn't allocate if its capacity is at least `compressed_bound(printing_data.size())`.
+     */
+    static void compress_printing_data(const std::vector<uint8_t>& printing_data, std::vector<uint8_t>& compressed);
+
+    /**
+     * Same as above, but appends compressed data to `out` (for example after job data of the page).
+     * It doesn't allocate if `out` has room for `compressed_bound(printing_data.size())` more bytes.
+     */
+    static void append_compressed_printing_data(const std::vector<uint8_t>& printing_data, std::vector<uint8_t>& out);
+
+    /**
+     * @return Maximal size of compressed printing data of the given size
+     */
+    [[nodiscard]] static constexpr size_t compressed_bound(const size_t size) noexcept {
+        // Raster data of a packet doesn't grow by more than one header byte (see `encode()`)
+        return size + size / RasterConverter::PACKET_SIZE;
+    }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_PACKBITS_H
@@ -0,0 +1,72 @@
+#include "PageBuilder.h"
+#include "PackBits.h"
+
+PageBuilder::PageBuilder(BufferPool& _buffers, PrinterJobStatistics& _statistics) noexcept
+    : buffers(_buffers),
+    statistics(_statistics) {}
+
+std::vector<uint8_t> PageBuilder::frame(const JobHeader& header, std::vector<uint8_t> printing_data,
+        const bool compress, const size_t extra) {
+    const size_t raster_size = printing_data.size();
+    const size_t data_bound = compress ? PackBits::compressed_bound(raster_size) : raster_size;
+
+    // The buffer has room for all of the parts, so appending them doesn't allocate
+    std::vector<uint8_t> message = buffers.acquire(header.size() + data_bound + extra);
+    message.assign(header.data(), header.data() + header.size());
+    if(compress)
+        PackBits::append_compressed_printing_data(printing_data, message);
+    else
+        message.insert(message.end(), printing_data.begin(), printing_data.end());
+    buffers.release(std::move(printing_data));
+
+    statistics.raster_bytes += raster_size;
+    statistics.sent_bytes += message.size() - header.size();
+
+    return message;
+}
+
+std::vector<uint8_t> PageBuilder::page(const JobHeader& header, std::vector<uint8_t> printing_data,
+        const bool last_page, const bool compress) {
+    std::vector<uint8_t> message = frame(header, std::move(printing_data), compress, 1);
+    message.push_back(EscpCommands::print_command(last_page));
+
+    ++statistics.pages;
+    statistics.raster_bytes += 1;
+    statistics.sent_bytes += 1;
+
+    return message;
+}
+
+std::vector<uint8_t> PageBuilder::first_strip(const JobHeader& header, std::vector<uint8_t> printing_data,
+        const bool compress) {
+    return frame(header, std::move(printing_data), compress, 0);
+}
+
+std::vector<uint8_t> PageBuilder::strip_data(std::vector<uint8_t> printing_data, const bool compress) {
+    statistics.raster_bytes += printing_data.size();
+
+    if(compress) {
+        std::vector<uint8_t> compressed = buffers.acquire(PackBits::compressed_bound(printing_data.size()));
+        PackBits::compress_printing_data(printing_data, compressed);
+        buffers.release(std::move(printing_data));
+        printing_data = std::move(compressed);
+    }
+
+    statistics.sent_bytes += printing_data.size();
+    return printing_data;
+}
+
+std::vector<uint8_t> PageBuilder::page_end(const bool last_page) {
+    std::vector<uint8_t> command = buffers.acquire(1);
+    command[0] = EscpCommands::print_command(last_page);
+
+    ++statistics.pages;
+    statistics.raster_bytes += 1;
+    statistics.sent_bytes += 1;
+
+    return command;
+}
+
+void PageBuilder::recycle(std::vector<uint8_t> buffer) noexcept {
+    buffers.release(std::move(buffer));
+}
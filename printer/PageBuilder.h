@@ -0,0 +1,83 @@
+#ifndef LABEL_PRINTER_DRIVER_PAGEBUILDER_H
+#define LABEL_PRINTER_DRIVER_PAGEBUILDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PrinterJobData.h"
+#include "../utils/BufferPool.h"
+
+/**
+ * Builds messages sent to the printer for each page in buffers taken from a `BufferPool`. Job data
+ * of a page always goes in one message with its printing data - the whole page with `page()`, or
+ * the first strip with `first_strip()` when the page is sent in strips. Buffers given to the builder
+ * and to `recycle()` are returned to the pool, so once the pool is warmed up no memory is allocated.
+ */
+class PageBuilder {
+private:
+    BufferPool& buffers;
+    PrinterJobStatistics& statistics;
+
+    /**
+     * Builds `header` followed by printing data (compressed if requested) in a buffer with room
+     * for `extra` more bytes. Printing data is returned to the pool.
+     */
+    [[nodiscard]] std::vector<uint8_t> frame(const JobHeader& header, std::vector<uint8_t> printing_data,
+            bool compress, size_t extra);
+
+public:
+    /**
+     * @param buffers Pool of the buffers, which must outlive the builder
+     * @param statistics Statistics updated with each built page
+     */
+    PageBuilder(BufferPool& buffers, PrinterJobStatistics& statistics) noexcept;
+
+    /**
+     * Builds the whole message of a page in one buffer - job data, printing data (compressed if
+     * requested) and the print command - so that the page is sent in a single transfer.
+     *
+     * @param header Job data of the page
+     * @param printing_data Printing data of the page, which is returned to the pool
+     * @param last_page Whether the page is the last one of the job (0x1a) or not (0x0c)
+     * @param compress Whether the data should be compressed with `PackBits`
+     * @return Message of the page
+     */
+    [[nodiscard]] std::vector<uint8_t> page(const JobHeader& header, std::vector<uint8_t> printing_data,
+            bool last_page, bool compress);
+
+    /**
+     * Builds job data of a page sent in strips followed by printing data of its first strip (compressed
+     * if requested), so that the first strip is sent in the same transfer as with `page()`.
+     *
+     * @param header Job data of the page
+     * @param printing_data Printing data of the first strip, which is returned to the pool
+     * @param compress Whether the data should be compressed with `PackBits`
+     * @return Start of the message of the page
+     */
+    [[nodiscard]] std::vector<uint8_t> first_strip(const JobHeader& header, std::vector<uint8_t> printing_data,
+            bool compress);
+
+    /**
+     * Compresses printing data of a following strip of the page (if requested). Page data of a page
+     * sent in strips is terminated by `page_end()`.
+     *
+     * @param printing_data Printing data of the strip, which is reused or returned to the pool
+     * @param compress Whether the data should be compressed with `PackBits`
+     * @return Part of page data
+     */
+    [[nodiscard]] std::vector<uint8_t> strip_data(std::vector<uint8_t> printing_data, bool compress);
+
+    /**
+     * @param last_page Whether the page is the last one of the job (0x1a) or not (0x0c)
+     * @return Print command which terminates page data sent in strips
+     */
+    [[nodiscard]] std::vector<uint8_t> page_end(bool last_page);
+
+    /**
+     * Returns already sent buffer to the pool.
+     */
+    void recycle(std::vector<uint8_t> buffer) noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_PAGEBUILDER_H
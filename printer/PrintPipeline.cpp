@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "PrintPipeline.h"
+#include "../label/RasterConverter.h"
+#include "../utils/Metrics.h"
+#include "../utils/Tracer.h"
+
+PrintPipeline::PrintPipeline(LabelSource _source, const PrintPipelineOptions& options, BufferPool *_buffers)
+    : source(std::move(_source)),
+    max_in_flight(std::max<size_t>(options.max_in_flight, 1)),
+    buffers(_buffers),
+    rendered(max_in_flight),
+    rasterized(max_in_flight),
+    active_renderers(std::max<size_t>(options.render_workers, 1)),
+    active_rasterizers(std::max<size_t>(options.raster_workers, 1)) {
+    reorder_buffer.resize(max_in_flight);
+
+    const size_t renderers = active_renderers;
+    const size_t rasterizers = active_rasterizers;
+
+    for(size_t i = 0; i < renderers; ++i)
+        workers.emplace_back(&PrintPipeline::render_worker, this);
+    for(size_t i = 0; i < rasterizers; ++i)
+        workers.emplace_back(&PrintPipeline::raster_worker, this);
+}
+
+PrintPipeline::PrintPipeline(const std::vector<Label*>& labels, const PrintPipelineOptions& options,
+        BufferPool *_buffers)
+    : PrintPipeline(make_label_source(labels.begin(), labels.end()), options, _buffers) {}
+
+PrintPipeline::~PrintPipeline() noexcept {
+    stop(nullptr);
+    for(auto& worker: workers)
+        worker.join();
+}
+
+std::optional<std::pair<size_t, std::shared_ptr<const Label>>> PrintPipeline::take_label() {
+    std::unique_lock lock(dispatch_mutex);
+    dispatch_cv.wait(lock, [this] {
+        return stopped || exhausted || next_index < delivered + max_in_flight;
+    });
+
+    if(stopped || exhausted)
+        return std::nullopt;
+
+    // The source is called under the lock, so it is called from one thread at a time and in order of indices
+    std::shared_ptr<const Label> label = source();
+    if(!label) {
+        exhausted = true;
+        lock.unlock();
+        dispatch_cv.notify_all();
+        return std::nullopt;
+    }
+
+    const size_t index = next_index++;
+    lock.unlock();
+    dispatch_cv.notify_all();
+    return std::make_pair(index, std::move(label));
+}
+
+void PrintPipeline::render_worker() noexcept {
+    try {
+        while(auto taken = take_label()) {
+            std::unique_ptr<RenderedLabel> label;
+            {
+                StageTimer timer(PrintStage::RENDER);
+                TraceSpan span("render", "label");
+                span.set_arg("label", static_cast<int64_t>(taken->first));
+                label = taken->second->render();
+            }
+            if(!rendered.push({taken->first, std::move(taken->second), std::move(label)}))
+                break;
+        }
+    }
+    catch(...) {
+        stop(std::current_exception());
+    }
+
+    if(--active_renderers == 0)
+        rendered.close();
+}
+
+void PrintPipeline::raster_worker() noexcept {
+    try {
+        while(auto item = rendered.pop()) {
+            std::vector<uint8_t> printing_data {};
+            if(buffers != nullptr)
+                printing_data = buffers->acquire(item->label->get_format().dimensions.width_pt * RasterConverter::PACKET_SIZE);
+            {
+                StageTimer timer(PrintStage::RASTERIZE);
+                TraceSpan span("rasterize", "label");
+                span.set_arg("label", static_cast<int64_t>(item->index));
+                item->label->rasterize(item->rendered.get(), printing_data);
+            }
+            // Only printing data is kept until the page is sent
+            item->rendered.reset();
+            item->label.reset();
+
+            if(!rasterized.push({item->index, std::move(printing_data)}))
+                break;
+        }
+    }
+    catch(...) {
+        stop(std::current_exception());
+    }
+
+    if(--active_rasterizers == 0)
+        rasterized.close();
+}
+
+void PrintPipeline::stop(std::exception_ptr reason) noexcept {
+    {
+        std::lock_guard lock(dispatch_mutex);
+        if(reason && !error)
+            error = std::move(reason);
+        stopped = true;
+    }
+
+    dispatch_cv.notify_all();
+    rendered.close();
+    rasterized.close();
+}
+
+std::optional<std::vector<uint8_t>> PrintPipeline::next() {
+    const size_t index = delivered;
+    if(!has_next())
+        return std::nullopt;
+
+    // Pages may be finished out of order when there is more than one worker in a stage
+    std::optional<std::vector<uint8_t>>& slot = reorder_buffer[index % max_in_flight];
+    while(!slot) {
+        std::optional<RasterItem> item = rasterized.pop();
+        {
+            std::lock_guard lock(dispatch_mutex);
+            if(error)
+                std::rethrow_exception(error);
+        }
+        if(!item)
+            throw std::runtime_error("Print pipeline stopped before all of the pages were prepared");
+
+        reorder_buffer[item->first % max_in_flight] = std::move(item->second);
+    }
+
+    std::vector<uint8_t> printing_data = std::move(slot.value());
+    slot.reset();
+
+    {
+        std::lock_guard lock(dispatch_mutex);
+        ++delivered;
+    }
+    dispatch_cv.notify_all();
+
+    return printing_data;
+}
+
+bool PrintPipeline::has_next() {
+    std::unique_lock lock(dispatch_mutex);
+    dispatch_cv.wait(lock, [this] {
+        return error || stopped || exhausted || next_index > delivered;
+    });
+
+    if(error)
+        std::rethrow_exception(error);
+    return next_index > delivered;
+}
@@ -0,0 +1,123 @@
+#ifndef LABEL_PRINTER_DRIVER_PRINTPIPELINE_H
+#define LABEL_PRINTER_DRIVER_PRINTPIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "../label/Label.h"
+#include "../label/LabelSource.h"
+#include "../utils/BoundedQueue.h"
+#include "../utils/BufferPool.h"
+
+struct PrintPipelineOptions {
+    size_t render_workers = 1;  /**< Threads calling `Label::render()` - more than 1 requires thread-safe labels */
+    size_t raster_workers = 1;  /**< Threads calling `Label::rasterize(const RenderedLabel*)` */
+    size_t max_in_flight = 4;  /**< Maximal number of labels which are rendered ahead of the writer */
+};
+
+/**
+ * Prepares printing data of a batch of labels in stages running on separate threads:
+ * render workers feed rasterizers through a bounded queue and rasterizers feed
+ * the writer (the thread calling `next()`) through another one.
+ *
+ * Pages are handed over to the writer in the order of the labels. Labels are pulled
+ * from the source only as rendering needs them, and rendering never gets more than
+ * `max_in_flight` labels ahead of the writer, so a slow printer slows down (and does
+ * not flood) the earlier stages - and only that many labels are held at once.
+ *
+ * @see Label::render(), Label::rasterize(const RenderedLabel*)
+ */
+class PrintPipeline {
+private:
+    struct RenderedItem {
+        size_t index;
+        std::shared_ptr<const Label> label;  /**< Kept until the label is rasterized */
+        std::unique_ptr<RenderedLabel> rendered;
+    };
+    using RasterItem = std::pair<size_t, std::vector<uint8_t>>;
+
+    LabelSource source;
+    const size_t max_in_flight;
+    BufferPool *buffers;
+
+    std::mutex dispatch_mutex;
+    std::condition_variable dispatch_cv;
+    size_t next_index = 0;  /**< Index of the next label to take from `source` */
+    size_t delivered = 0;  /**< Number of pages taken by the writer */
+    bool exhausted = false;  /**< Whether `source` has run out of labels */
+    bool stopped = false;
+    std::exception_ptr error;
+
+    BoundedQueue<RenderedItem> rendered;
+    BoundedQueue<RasterItem> rasterized;
+    /**
+     * Pages finished ahead of the writer. Only `max_in_flight` labels are in progress at once,
+     * so a page with index `i` is stored at `i % max_in_flight`.
+     */
+    std::vector<std::optional<std::vector<uint8_t>>> reorder_buffer;
+
+    std::atomic<size_t> active_renderers;
+    std::atomic<size_t> active_rasterizers;
+    std::vector<std::thread> workers;
+
+    /**
+     * Takes the next label from the source once it may be rendered.
+     *
+     * @return Index and the label, `std::nullopt` if there are no more labels or the pipeline is stopped
+     */
+    std::optional<std::pair<size_t, std::shared_ptr<const Label>>> take_label();
+    void render_worker() noexcept;
+    void raster_worker() noexcept;
+    void stop(std::exception_ptr reason) noexcept;
+
+public:
+    /**
+     * Starts worker threads. `buffers` must outlive the pipeline.
+     *
+     * @param source Labels to prepare, it is called by the worker threads (one at a time) and its
+     * exceptions are thrown by `next()`
+     * @param options Number of workers and size of the window
+     * @param buffers Pool of buffers for printing data (see `Label::rasterize(const RenderedLabel*, std::vector<uint8_t>&)`),
+     * pages returned by `next()` can be released to it
+     */
+    PrintPipeline(LabelSource source, const PrintPipelineOptions& options, BufferPool *buffers = nullptr);
+
+    /**
+     * Same as above with labels of a vector, which must outlive the pipeline.
+     */
+    PrintPipeline(const std::vector<Label*>& labels, const PrintPipelineOptions& options, BufferPool *buffers = nullptr);
+
+    /**
+     * Stops the workers (unfinished pages are dropped) and joins them.
+     */
+    ~PrintPipeline() noexcept;
+
+    PrintPipeline(const PrintPipeline&) = delete;
+    PrintPipeline& operator=(const PrintPipeline&) = delete;
+
+    /**
+     * Returns printing data of the next label. Blocks until it is ready.
+     *
+     * @return Printing data or `std::nullopt` if all of the labels have been taken
+     *
+     * @throws Any exception thrown while rendering or rasterizing a label
+     */
+    std::optional<std::vector<uint8_t>> next();
+
+    /**
+     * Tells whether there is a page after those taken by `next()`, so that the last page of a job
+     * can be marked before it is sent. Blocks until the next label is taken from the source (it
+     * doesn't wait for the label to be rendered) or the source runs out of labels.
+     *
+     * @throws Any exception thrown by the source or while rendering or rasterizing a label
+     */
+    [[nodiscard]] bool has_next();
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_PRINTPIPELINE_H
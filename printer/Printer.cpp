@@ -1,50 +1,114 @@
 #include "Printer.h"
 #include "PrinterStatus.h"
-#include <iostream>
+#include "PackBits.h"
+#include "AsyncTransport.h"
+#include "StatusMonitor.h"
+#include "UsbTransport.h"
+#include "../exceptions/PrinterError.h"
+#include "../label/RasterConverter.h"
+#include "../utils/Logger.h"
+#include "../utils/Metrics.h"
+#include "../utils/Tracer.h"
+#include <algorithm>
+#include <tuple>
 #include <unistd.h>
 #include <array>
 #include <cstring>
+#include <deque>
 #include <vector>
 
-using std::cout, std::endl;
+namespace {
+    /**
+     * Counts printed labels, errors and cooling periods which the printer reports with `status`.
+     */
+    void count_status(const PrinterStatus& status) noexcept {
+        switch(static_cast<StatusType>(status.status_code)) {
+            case StatusType::PRINTING_COMPLETED:
+                Metrics::increment(PrintCounter::LABELS_PRINTED);
+                break;
+            case StatusType::ERROR_OCCURRED:
+                Metrics::increment(PrintCounter::PRINTER_ERRORS);
+                break;
+            case StatusType::NOTIFICATION:
+                if(static_cast<NotificationType>(status.notification_code) == NotificationType::COOLING_START)
+                    Metrics::increment(PrintCounter::COOLING_EVENTS);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Frees list from `libusb_get_device_list()` and unreferences its devices.
+     */
+    struct DeviceListDeleter {
+        void operator()(libusb_device **device_list) const noexcept {
+            libusb_free_device_list(device_list, 1);
+        }
+    };
+
+    /** Device list which is freed even if opening of a device throws */
+    using DeviceList = std::unique_ptr<libusb_device*[], DeviceListDeleter>;
+}
+
+std::string PrinterLocation::to_string() const {
+    std::string str = std::to_string(bus) + "-";
+    for(size_t i = 0; i < ports.size(); ++i)
+        str += (i > 0 ? "." : "") + std::to_string(ports[i]);
+    return str;
+}
+
+bool PrinterLocation::operator==(const PrinterLocation& other) const noexcept {
+    return bus == other.bus && ports == other.ports;
+}
+
+bool PrinterLocation::operator<(const PrinterLocation& other) const noexcept {
+    return std::tie(bus, ports) < std::tie(other.bus, other.ports);
+}
 
 Printer::Printer() {
-    cout << "Initializing libusb... ";
     check_usb_error_throw(libusb_init(&ctx), "constructor");
-    cout << "done!" << endl;
+    Logger::info("Initializing libusb... done!");
 }
 
+Printer::Printer(std::unique_ptr<Transport> _transport)
+    : transport(std::move(_transport)) {}
+
 Printer::~Printer() noexcept {
     cleanup();
 }
 
 void Printer::cleanup() noexcept {
-    cout << "Performing cleanup for Printer..." << endl;
+    Logger::info("Performing cleanup for Printer...");
+
+    stop_hotplug();
+    transport.reset();
 
     if(printer != nullptr) {
-        cout << " -> Releasing interface... ";
         if(!check_usb_error(libusb_release_interface(printer, BROTHER_INTERFACE)))
-            cout << "done!" << endl;
+            Logger::info(" -> Releasing interface... done!");
 
-        cout << " -> Closing printer handle... ";
         libusb_close(printer);
-        cout << "done!" << endl;
+        printer = nullptr;
+        Logger::info(" -> Closing printer handle... done!");
     }
 
-    cout << " -> Deinitializing libusb... ";
-    libusb_exit(ctx);
-    cout << "done!" << endl;
+    if(ctx != nullptr) {
+        libusb_exit(ctx);
+        ctx = nullptr;
+        Logger::info(" -> Deinitializing libusb... done!");
+    }
 
-    cout << "Cleanup finished" << endl;
+    Logger::info("Cleanup finished");
 }
 
-void Printer::libusb_error_to_stderr(const int error_code) noexcept {
-    std::cerr << "libusb error: " << libusb_error_name(error_code) << endl;
+void Printer::log_libusb_error(const int error_code) noexcept {
+    Logger::error("libusb error: ", libusb_error_name(error_code));
 }
 
 bool Printer::check_usb_error(const int ret) noexcept {
     if(ret < LIBUSB_SUCCESS) {
-        libusb_error_to_stderr(ret);
+        log_libusb_error(ret);
         return true;
     }
     return false;
@@ -58,84 +122,332 @@ void Printer::check_usb_error_throw(const int ret, const std::string& where, boo
     }
 }
 
+bool Printer::is_brother_printer(libusb_device *device) {
+    libusb_device_descriptor desc {};
+    check_usb_error_throw(libusb_get_device_descriptor(device, &desc), "getting device descriptor");
+    return desc.idVendor == BROTHER_VID && desc.idProduct == BROTHER_PID;
+}
+
+PrinterLocation Printer::locate(libusb_device *device) {
+    PrinterLocation location {};
+    location.bus = libusb_get_bus_number(device);
+
+    std::array<uint8_t, 7> ports {};  // USB 3.0 allows up to 7 levels of ports
+    const int port_count = libusb_get_port_numbers(device, ports.data(), ports.size());
+    if(port_count > 0)
+        location.ports.assign(ports.begin(), ports.begin() + port_count);
+
+    return location;
+}
+
+void Printer::open_device(libusb_device *device, const bool clean) {
+    check_usb_error_throw(libusb_open(device, &printer), "opening device", clean);
+    Logger::info(" -> Opening device... done!");
+
+    check_usb_error_throw(libusb_set_auto_detach_kernel_driver(printer, 1), "setting auto detach kernel", clean);
+    Logger::info(" -> Detaching kernel driver... done!");
+
+    check_usb_error_throw(libusb_claim_interface(printer, BROTHER_INTERFACE), "claiming interface", clean);
+    Logger::info(" -> Claiming interface... done!");
+
+    transport = std::make_unique<UsbTransport>(printer, BROTHER_ENDPOINT_IN, BROTHER_ENDPOINT_OUT);
+
+    std::lock_guard lock(connection_mutex);
+    location = locate(device);
+    connected_device = device;
+}
+
+void Printer::open_arrived_device(libusb_device *device) {
+    try {
+        open_device(device, false);
+    }
+    catch(...) {
+        libusb_unref_device(device);
+        close_device();
+        throw;
+    }
+    libusb_unref_device(device);
+}
+
+void Printer::close_device() noexcept {
+    {
+        std::lock_guard lock(connection_mutex);
+        connected_device = nullptr;
+    }
+
+    transport.reset();
+    if(printer != nullptr) {
+        libusb_release_interface(printer, BROTHER_INTERFACE);  // Fails if the printer is gone, which doesn't matter
+        libusb_close(printer);
+        printer = nullptr;
+    }
+}
+
+bool Printer::enable_hotplug() {
+    if(hotplug_enabled)
+        return true;
+    if(ctx == nullptr || !libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+        return false;
+
+    // Already connected printers are reported right away (as arrived)
+    check_usb_error_throw(libusb_hotplug_register_callback(ctx,
+            static_cast<libusb_hotplug_event>(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            LIBUSB_HOTPLUG_ENUMERATE, BROTHER_VID, BROTHER_PID, LIBUSB_HOTPLUG_MATCH_ANY, on_hotplug, this,
+            &hotplug_handle), "registering hotplug callback", false);
+
+    hotplug_enabled = true;
+    hotplug_running = true;
+    hotplug_thread = std::thread(&Printer::handle_hotplug_events, this);
+
+    return true;
+}
+
+void Printer::stop_hotplug() noexcept {
+    if(!hotplug_enabled)
+        return;
+
+    hotplug_running = false;
+    libusb_hotplug_deregister_callback(ctx, hotplug_handle);
+    hotplug_thread.join();
+    hotplug_enabled = false;
+
+    std::lock_guard lock(connection_mutex);
+    if(arrived_device != nullptr) {
+        libusb_unref_device(arrived_device);
+        arrived_device = nullptr;
+    }
+}
+
+void Printer::handle_hotplug_events() noexcept {
+    timeval timeout {0, 100000};
+    while(hotplug_running)
+        libusb_handle_events_timeout_completed(ctx, &timeout, nullptr);
+}
+
+int LIBUSB_CALL Printer::on_hotplug(libusb_context*, libusb_device *device, const libusb_hotplug_event event,
+        void *user_data) noexcept {
+    auto *self = static_cast<Printer*>(user_data);
+
+    // Devices can't be opened or closed here, only handed over to `wait_for_device()` or marked as gone
+    {
+        std::lock_guard lock(self->connection_mutex);
+        if(event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+            if(self->connected_device == nullptr && self->arrived_device == nullptr
+                    && (!self->location_pinned || locate(device) == self->location))
+                self->arrived_device = libusb_ref_device(device);
+        }
+        else {
+            if(device == self->connected_device)
+                self->connected_device = nullptr;
+            if(device == self->arrived_device) {
+                libusb_unref_device(self->arrived_device);
+                self->arrived_device = nullptr;
+            }
+        }
+    }
+    self->connection_changed.notify_all();
+
+    return 0;
+}
+
+libusb_device *Printer::wait_for_device(const std::chrono::milliseconds timeout) {
+    std::unique_lock lock(connection_mutex);
+    if(!connection_changed.wait_for(lock, timeout, [this] { return arrived_device != nullptr; }))
+        return nullptr;
+
+    libusb_device *device = arrived_device;
+    arrived_device = nullptr;
+    return device;
+}
+
+bool Printer::is_connected() noexcept {
+    std::lock_guard lock(connection_mutex);
+    return transport != nullptr && (printer == nullptr || !hotplug_enabled || connected_device != nullptr);
+}
+
+bool Printer::reconnect(const std::chrono::milliseconds timeout) {
+    if(is_connected())
+        return true;
+    close_device();
+
+    if(hotplug_enabled) {
+        libusb_device *device = wait_for_device(timeout);
+        if(device == nullptr)
+            return false;
+        open_arrived_device(device);
+    }
+    else {
+        // Without hotplug the device list is checked once
+        libusb_device **devices;
+        const auto device_count = libusb_get_device_list(ctx, &devices);
+        check_usb_error_throw(device_count, "getting device list", false);
+        const DeviceList device_list(devices);
+
+        libusb_device *found = nullptr;
+        for(auto i = 0; i < device_count && found == nullptr; ++i) {
+            if(is_brother_printer(device_list[i]) && (!location_pinned || locate(device_list[i]) == location))
+                found = libusb_ref_device(device_list[i]);
+        }
+
+        if(found == nullptr) {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+        open_arrived_device(found);
+    }
+
+    Logger::info("Printer reconnected at ", location.to_string());
+    return true;
+}
+
 void Printer::scan_for_printer(uint8_t scan_timeout) {
-    libusb_device **device_list;
+    TraceSpan span("scan_for_printer", "usb");
+
+    if(enable_hotplug()) {
+        Logger::info("Waiting for printer...");
+
+        libusb_device *device;
+        while((device = wait_for_device(std::chrono::seconds(scan_timeout))) == nullptr)
+            Logger::info("Printer not found! Still waiting...");
+
+        Logger::info("Printer found!");
+        open_arrived_device(device);
+
+        Logger::info("Scan finished!");
+        return;
+    }
+
+    libusb_device **devices;
     bool found = false;
 
-    cout << "Scanning for printer..." << endl;
+    Logger::info("Scanning for printer...");
     while(!found) {
-        auto device_count = libusb_get_device_list(ctx, &device_list);
+        auto device_count = libusb_get_device_list(ctx, &devices);
         check_usb_error_throw(device_count, "getting device list");
+        const DeviceList device_list(devices);
 
         for(auto i = 0; i < device_count; ++i) {
-            libusb_device_descriptor desc {};
-            check_usb_error_throw(libusb_get_device_descriptor(device_list[i], &desc), "getting device descriptor");
-
-            if(desc.idVendor == BROTHER_VID && desc.idProduct == BROTHER_PID) {
-                cout << "Printer found!" << endl;
-                cout << " -> Opening device... ";
-                check_usb_error_throw(libusb_open(device_list[i], &printer), "opening device");
-                cout << "done!" << endl;
-
-                cout << " -> Detaching kernel driver... ";
-                check_usb_error_throw(libusb_set_auto_detach_kernel_driver(printer, 1), "setting auto detach kernel");
-                cout << "done!" << endl;
-
-                cout << " -> Claiming interface... ";
-                check_usb_error_throw(libusb_claim_interface(printer, BROTHER_INTERFACE), "claiming interface");
-                cout << "done!" << endl;
+            if(is_brother_printer(device_list[i])) {
+                Logger::info("Printer found!");
+                open_device(device_list[i]);
 
                 found = true;
                 break;
             }
         }
 
-        libusb_free_device_list(device_list, 1);
-
         if(!found) {
-            cout << "Printer not found! Retrying in " << scan_timeout << " seconds..." << endl;
+            Logger::info("Printer not found! Retrying in ", scan_timeout, " seconds...");
             sleep(scan_timeout);
         }
     }
 
-    cout << "Scan finished!" << endl;
+    Logger::info("Scan finished!");
+}
+
+void Printer::open(const PrinterLocation& _location) {
+    {
+        std::lock_guard lock(connection_mutex);
+        location = _location;
+        location_pinned = true;
+    }
+
+    libusb_device **devices;
+    auto device_count = libusb_get_device_list(ctx, &devices);
+    check_usb_error_throw(device_count, "getting device list");
+    const DeviceList device_list(devices);
+
+    bool found = false;
+    for(auto i = 0; i < device_count && !found; ++i) {
+        if(is_brother_printer(device_list[i]) && locate(device_list[i]) == _location) {
+            Logger::info("Opening printer at ", _location.to_string());
+            open_device(device_list[i]);
+            found = true;
+        }
+    }
+
+    if(!found)
+        throw USBError("no printer at " + _location.to_string(), "opening device");
+}
+
+std::vector<PrinterLocation> Printer::find_printers() {
+    libusb_context *context = nullptr;
+    int ret = libusb_init(&context);
+    if(ret < LIBUSB_SUCCESS)
+        throw USBError(libusb_error_name(ret), "finding printers");
+
+    libusb_device **device_list;
+    const auto device_count = libusb_get_device_list(context, &device_list);
+    if(device_count < LIBUSB_SUCCESS) {
+        libusb_exit(context);
+        throw USBError(libusb_error_name(static_cast<int>(device_count)), "finding printers");
+    }
+
+    std::vector<PrinterLocation> locations {};
+    for(auto i = 0; i < device_count; ++i) {
+        libusb_device_descriptor desc {};
+        if(libusb_get_device_descriptor(device_list[i], &desc) == LIBUSB_SUCCESS
+                && desc.idVendor == BROTHER_VID && desc.idProduct == BROTHER_PID)
+            locations.push_back(locate(device_list[i]));
+    }
+
+    libusb_free_device_list(device_list, 1);
+    libusb_exit(context);
+
+    std::sort(locations.begin(), locations.end());
+    return locations;
+}
+
+const PrinterLocation& Printer::get_location() const noexcept {
+    return location;
 }
 
-void Printer::send(std::vector<uint8_t>& data) {
-    int actual;
-    check_usb_error_throw(
-            libusb_bulk_transfer(printer, BROTHER_ENDPOINT_IN, data.data(), data.size(), &actual, 0),
-            "sending data",
-            false);
+void Printer::send(std::vector<uint8_t>& data, const unsigned timeout_ms) {
+    if(transport == nullptr)
+        throw USBError(libusb_error_name(LIBUSB_ERROR_NO_DEVICE), "sending data");
 
-    cout << " [<< " << actual << "] ";
+    TraceSpan span("bulk_transfer", "usb");
+    span.set_arg("bytes", static_cast<int64_t>(data.size()));
+
+    const auto start = Metrics::Clock::now();
+    size_t actual;
+    try {
+        actual = transport->send(data.data(), data.size(), timeout_ms);
+    }
+    catch(...) {
+        Metrics::increment(PrintCounter::TRANSFER_ERRORS);
+        throw;
+    }
+    Metrics::record(PrintStage::USB_SEND, Metrics::Clock::now() - start);
+    Metrics::increment(PrintCounter::BYTES_SENT, actual);
+
+    Logger::debug("Sent ", actual, " bytes");
 }
 
 PrinterStatus Printer::receive_status() {
     constexpr size_t RECV_BUFFER_SIZE = 32;
     std::array<uint8_t, RECV_BUFFER_SIZE> buffer {};
 
-    int actual;
-    check_usb_error_throw(
-            libusb_bulk_transfer(printer, BROTHER_ENDPOINT_OUT, buffer.data(), RECV_BUFFER_SIZE, &actual, 0),
-            "receiving data",
-            false
-            );
+    if(transport == nullptr)
+        throw USBError(libusb_error_name(LIBUSB_ERROR_NO_DEVICE), "receiving data");
+
+    TraceSpan span("status", "usb");
+    const size_t actual = transport->receive(buffer.data(), RECV_BUFFER_SIZE, 0);
 
-    cout << " [>> " << actual << "] ";
-    return PrinterStatus(buffer);
+    Logger::debug("Received ", actual, " bytes");
+    PrinterStatus status(buffer);
+    span.set_arg("status", status.status_code);
+    return status;
 }
 
 PrinterStatus Printer::send_request_status() {
     std::vector<uint8_t> request_status_cmd {0x1b, 0x69, 0x53};
 
-    cout << "Requesting status information... ";
     send(request_status_cmd);
-    cout << "done!" << endl;
+    Logger::info("Requesting status information... done!");
 
-    cout << "Waiting for response... ";
     PrinterStatus status = receive_status();
-    cout << "done!" << endl;
+    Logger::info("Waiting for response... done!");
 
     return status;
 }
@@ -143,51 +455,301 @@ PrinterStatus Printer::send_request_status() {
 void Printer::clear_jobs() {
     std::vector<uint8_t> clear_jobs_cmd(200, 0x00);
 
-    cout << "Clearing printer jobs... ";
     send(clear_jobs_cmd);
-    cout << "done!" << endl;
+    Logger::info("Clearing printer jobs... done!");
 }
 
 void Printer::init() {
     std::vector<uint8_t> init_cmd {0x1b, 0x40};
 
-    cout << "Initializing printer... ";
     send(init_cmd);
-    cout << "done!" << endl;
+    Logger::info("Initializing printer... done!");
 }
 
-void Printer::send_job_data(const PrinterJobData& job_data) {
-    std::vector<uint8_t> raw_data(job_data.construct_job_data_message());
+void Printer::send_page(PageBuilder& builder, const JobHeader& header, std::vector<uint8_t> printing_data,
+        const bool last_page, const bool compress, const unsigned timeout_ms) {
+    std::vector<uint8_t> page = builder.page(header, std::move(printing_data), last_page, compress);
 
-    cout << "Sending job data... ";
-    send(raw_data);
-    cout << "done!" << endl;
+    send(page, timeout_ms);
+    Logger::debug("Sending job data and page data... done!");
+
+    builder.recycle(std::move(page));
 }
 
-void Printer::send_page_data(const Label& label, const bool last_page) {
-    std::vector<uint8_t> page_data = label.get_printing_data();
-    page_data.push_back(last_page ? 0x1a : 0x0c);
+bool Printer::transfers_async() const noexcept {
+    return async_transfers && printer != nullptr;
+}
 
-    cout << "Sending page data... ";
-    send(page_data);
-    cout << "done!" << endl;
+void Printer::set_async_transfers(const bool enabled) noexcept {
+    async_transfers = enabled;
+}
+
+void Printer::set_pipeline_options(const PrintPipelineOptions& options) noexcept {
+    pipeline_options = options;
+}
+
+void Printer::set_send_ahead_window(const size_t pages) noexcept {
+    send_ahead_window = std::max<size_t>(pages, 1);
 }
 
 void Printer::print(const std::vector<Label*>& labels, PrinterJobData job_data) {
+    // Labels of a vector are checked before anything is printed
+    for(const Label *label: labels) {
+        if(label->get_format() != job_data.get_format())
+            throw std::invalid_argument("All labels must have the same media format as the print job");
+    }
+
+    print(make_label_source(labels.begin(), labels.end()), std::move(job_data));
+}
+
+void Printer::print(LabelSource labels, PrinterJobData job_data) {
+    LabelSource checked = [labels = std::move(labels), format = job_data.get_format()] {
+        std::shared_ptr<const Label> label = labels();
+        if(label && label->get_format() != format)
+            throw std::invalid_argument("All labels must have the same media format as the print job");
+        return label;
+    };
+
+    TraceSpan span("print_job", "job");
+
     clear_jobs();
     init();
 
+    job_statistics = {};
     job_data.set_is_starting_page(true);
-    for(size_t i = 0; i < labels.size(); ++i) {
-        if(i == 1)
-            job_data.set_is_starting_page(false);
+    Metrics::increment(PrintCounter::JOBS);
+
+    // Printing data and messages of all of the pages which can be in flight, so that the print loop doesn't allocate
+    page_buffers.reserve(std::max<size_t>(pipeline_options.max_in_flight, 1)
+            + std::max(send_ahead_window, AsyncTransport::DEFAULT_MAX_IN_FLIGHT) + 2,
+            job_data.get_format().dimensions.width_pt * RasterConverter::PACKET_SIZE);
+
+    PrintPipeline pipeline(std::move(checked), pipeline_options, &page_buffers);
+    if(send_ahead_window > 1)
+        print_windowed(pipeline, job_data);
+    else if(transfers_async())
+        print_async(pipeline, job_data);
+    else
+        print_sync(pipeline, job_data);
+
+    span.set_arg("pages", static_cast<int64_t>(job_statistics.pages));
+    Logger::info("Sent ", job_statistics.sent_bytes, " bytes of page data (saved ", job_statistics.bytes_saved(),
+            " bytes)");
+}
+
+void Printer::print_sync(PrintPipeline& pipeline, const PrinterJobData& job_data) {
+    PageBuilder builder(page_buffers, job_statistics);
+    JobHeader header = job_data.construct_job_header();
+
+    for(size_t i = 0; std::optional<std::vector<uint8_t>> printing_data = pipeline.next(); ++i) {
+        header.set_starting_page(i == 0);
+        send_page(builder, header, std::move(*printing_data), !pipeline.has_next(), job_data.is_compressed());
+
+        receive_page_status(Metrics::Clock::now());
+    }
+}
+
+void Printer::print_async(PrintPipeline& pipeline, const PrinterJobData& job_data) {
+    PageBuilder builder(page_buffers, job_statistics);
+    JobHeader header = job_data.construct_job_header();
+    AsyncTransport async_transport(ctx, printer, BROTHER_ENDPOINT_IN, AsyncTransport::DEFAULT_MAX_IN_FLIGHT,
+            &page_buffers);
+    std::array<Metrics::Clock::time_point, 2> submitted {};  // Of the current and the next page
+
+    // Queues job data and page data of the next page as one transfer, if there is one
+    size_t pages = 0;
+    const auto submit_next_page = [&] {
+        std::optional<std::vector<uint8_t>> printing_data = pipeline.next();
+        if(!printing_data)
+            return;
+
+        header.set_starting_page(pages == 0);
+        async_transport.submit(builder.page(header, std::move(*printing_data), !pipeline.has_next(),
+                job_data.is_compressed()));
+        submitted[pages++ % 2] = Metrics::Clock::now();
+        Logger::debug("Submitting job data and page data... done!");
+    };
+
+    submit_next_page();
+
+    for(size_t i = 0; i < pages; ++i) {
+        // Queue the next page while the current one is still being transferred or printed
+        submit_next_page();
+
+        receive_page_status(submitted[i % 2]);
+    }
+
+    async_transport.wait_all();
+}
+
+void Printer::print_windowed(PrintPipeline& pipeline, const PrinterJobData& job_data) {
+    PageBuilder builder(page_buffers, job_statistics);
+    JobHeader header = job_data.construct_job_header();
+    StatusMonitor monitor(*transport);
+
+    // Each page in the window can be in flight
+    std::optional<AsyncTransport> async_transport;
+    if(transfers_async()) {
+        async_transport.emplace(ctx, printer, BROTHER_ENDPOINT_IN,
+                std::max(AsyncTransport::DEFAULT_MAX_IN_FLIGHT, send_ahead_window), &page_buffers, SEND_TIMEOUT_MS);
+    }
+
+    // Times when pages in the window were sent, oldest first
+    std::deque<Metrics::Clock::time_point> sent {};
+
+    size_t printed = 0;
+    const auto handle_status = [&](const PrinterStatus& status) {
+        status.display(LogLevel::DEBUG);
+        count_status(status);
+
+        switch(static_cast<StatusType>(status.status_code)) {
+            case StatusType::PRINTING_COMPLETED:
+                ++printed;
+                if(!sent.empty()) {
+                    Metrics::record(PrintStage::PRINT_WAIT, Metrics::Clock::now() - sent.front());
+                    sent.pop_front();
+                }
+                break;
+            case StatusType::ERROR_OCCURRED:
+                if(async_transport)
+                    async_transport->cancel();
+                status.check_error_throw();
+                throw PrinterError("Unknown error");
+            default:
+                break;
+        }
+    };
+
+    // Takes status events until the next page is printed
+    const auto wait_for_page = [&] {
+        const size_t target = printed + 1;
+        while(printed < target)
+            handle_status(monitor.next());
+    };
+
+    size_t pages = 0;
+    while(pipeline.has_next()) {
+        while(pages - printed >= send_ahead_window)
+            wait_for_page();
+
+        std::vector<uint8_t> printing_data = pipeline.next().value();
+        const bool last_page = !pipeline.has_next();
+
+        // The window isn't full, but the printer could have failed meanwhile and it would reject the page
+        while(std::optional<PrinterStatus> status = monitor.try_next())
+            handle_status(*status);
+
+        header.set_starting_page(pages == 0);
+        if(async_transport) {
+            async_transport->submit(builder.page(header, std::move(printing_data), last_page, job_data.is_compressed()));
+            Logger::debug("Submitting job data and page data... done!");
+        }
+        else {
+            send_page(builder, header, std::move(printing_data), last_page, job_data.is_compressed(),
+                    SEND_TIMEOUT_MS);
+        }
+        sent.push_back(Metrics::Clock::now());
+        ++pages;
+    }
+
+    while(printed < pages)
+        wait_for_page();
 
-        send_job_data(job_data);
-        send_page_data(*labels[i], i == labels.size() - 1);
+    if(async_transport)
+        async_transport->wait_all();
+}
+
+void Printer::print_streaming(const Label& label, PrinterJobData job_data, const uint32_t strip_columns) {
+    if(label.get_format() != job_data.get_format())
+        throw std::invalid_argument("Label must have the same media format as the print job");
+    if(strip_columns == 0)
+        throw std::invalid_argument("Strip must have at least one column");
+
+    const std::unique_ptr<LabelStrips> strips = label.render_strips();
+    if(!strips)
+        throw std::invalid_argument("Label can't be rendered in strips");
+
+    TraceSpan span("print_job", "job");
+    span.set_arg("pages", 1);
+
+    clear_jobs();
+    init();
+
+    job_statistics = {};
+    job_data.set_is_starting_page(true);
+    Metrics::increment(PrintCounter::JOBS);
+
+    PageBuilder builder(page_buffers, job_statistics);
+    const JobHeader header = job_data.construct_job_header();
+    const uint32_t width = label.get_format().dimensions.width_pt;
+
+    // Renders and rasterizes the strip starting with `first_column`, the first one goes with job data of the page
+    const auto strip_data = [&](const uint32_t first_column) {
+        const uint32_t columns = std::min(strip_columns, width - first_column);
+        std::vector<uint8_t> printing_data = page_buffers.acquire(columns * RasterConverter::PACKET_SIZE);
+        strips->rasterize(first_column, columns, printing_data);
+        if(first_column == 0)
+            return builder.first_strip(header, std::move(printing_data), job_data.is_compressed());
+        return builder.strip_data(std::move(printing_data), job_data.is_compressed());
+    };
+
+    if(transfers_async()) {
+        AsyncTransport async_transport(ctx, printer, BROTHER_ENDPOINT_IN, AsyncTransport::DEFAULT_MAX_IN_FLIGHT,
+                &page_buffers);
+
+        for(uint32_t column = 0; column < width; column += strip_columns)
+            async_transport.submit(strip_data(column));
+        async_transport.submit(builder.page_end(true));
+        Logger::debug("Submitting page data in strips... done!");
+
+        receive_page_status(Metrics::Clock::now());
+        async_transport.wait_all();
+    }
+    else {
+        for(uint32_t column = 0; column < width; column += strip_columns) {
+            std::vector<uint8_t> data = strip_data(column);
+            send(data);
+            builder.recycle(std::move(data));
+        }
+        std::vector<uint8_t> command = builder.page_end(true);
+        send(command);
+        builder.recycle(std::move(command));
+        Logger::debug("Sending page data in strips... done!");
 
-        PrinterStatus status = receive_status();
-        status.display();
-        PrinterStatus status_finished = receive_status();
-        status_finished.display();
+        receive_page_status(Metrics::Clock::now());
     }
+
+    Logger::info("Sent ", job_statistics.sent_bytes, " bytes of page data (saved ", job_statistics.bytes_saved(),
+            " bytes)");
+}
+
+void Printer::receive_page_status(const Metrics::Clock::time_point sent) {
+    // Notifications (such as start of cooling) can come between the statuses of the page
+    bool finished = false;
+    while(true) {
+        const PrinterStatus status = receive_status();
+        status.display(LogLevel::DEBUG);
+        count_status(status);
+
+        switch(static_cast<StatusType>(status.status_code)) {
+            case StatusType::PRINTING_COMPLETED:
+                Metrics::record(PrintStage::PRINT_WAIT, Metrics::Clock::now() - sent);
+                finished = true;
+                break;
+            case StatusType::ERROR_OCCURRED:
+                // Reads don't time out and the printer doesn't have to send anything after an error
+                status.check_error_throw();
+                throw PrinterError("Unknown error");
+            case StatusType::PHASE_CHANGE:
+                if(finished)
+                    return;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+const PrinterJobStatistics& Printer::get_job_statistics() const noexcept {
+    return job_statistics;
 }
@@ -4,11 +4,39 @@
 #include "../exceptions/USBError.h"
 #include "PrinterStatus.h"
 #include "PrinterJobData.h"
+#include "PrintPipeline.h"
+#include "PageBuilder.h"
+#include "Transport.h"
+#include "../utils/BufferPool.h"
+#include "../utils/Metrics.h"
 #include <libusb-1.0/libusb.h>
 #include <string>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+/**
+ * Physical location of a printer - USB bus and path of ports from the root hub -
+ * which stays the same as long as the printer is plugged into the same port.
+ */
+struct PrinterLocation {
+    uint8_t bus = 0;
+    std::vector<uint8_t> ports;
+
+    /**
+     * @return Location in the same form as in sysfs, for example `1-2.3`
+     */
+    [[nodiscard]] std::string to_string() const;
+
+    bool operator==(const PrinterLocation& other) const noexcept;
+    bool operator<(const PrinterLocation& other) const noexcept;
+};
+
 class Printer {
 private:
     static constexpr uint16_t BROTHER_VID = 0x04f9;
@@ -21,28 +49,251 @@ private:
 
     libusb_context *ctx = nullptr;
     libusb_device_handle *printer = nullptr;
+    std::unique_ptr<Transport> transport;  /**< Transport over `printer` or the one given to the constructor */
+    PrinterLocation location {};
+    bool location_pinned = false;  /**< Whether only the printer at `location` can be (re)connected */
+
+    /* Connection tracking, see `enable_hotplug()` */
+    bool hotplug_enabled = false;
+    libusb_hotplug_callback_handle hotplug_handle {};
+    std::atomic<bool> hotplug_running {false};
+    std::thread hotplug_thread;
+
+    std::mutex connection_mutex;
+    std::condition_variable connection_changed;
+    libusb_device *connected_device = nullptr;  /**< Device of `printer`, `nullptr` once it leaves */
+    libusb_device *arrived_device = nullptr;  /**< Referenced printer which arrived and hasn't been opened yet */
+
+    PrinterJobStatistics job_statistics {};
+    BufferPool page_buffers {};  /**< Printing data and messages of pages, reused from job to job */
+
+    bool async_transfers = false;
+    size_t send_ahead_window = 1;
+    PrintPipelineOptions pipeline_options {};
 
     void cleanup() noexcept;
     inline void check_usb_error_throw(const int ret, const std::string& where, bool clean = true);
     inline static bool check_usb_error(const int ret) noexcept;
-    inline static void libusb_error_to_stderr(const int error_code) noexcept;
+    inline static void log_libusb_error(const int error_code) noexcept;
 
-    void send(std::vector<uint8_t>& data);
+    bool is_brother_printer(libusb_device *device);
+    static PrinterLocation locate(libusb_device *device);
+    void open_device(libusb_device *device, bool clean = true);
+    void open_arrived_device(libusb_device *device);
+    void close_device() noexcept;
+
+    void stop_hotplug() noexcept;
+    void handle_hotplug_events() noexcept;
+    static int LIBUSB_CALL on_hotplug(libusb_context *ctx, libusb_device *device, libusb_hotplug_event event,
+            void *user_data) noexcept;
+
+    /**
+     * @return Referenced printer which arrived or `nullptr` if none arrived in time
+     */
+    libusb_device *wait_for_device(std::chrono::milliseconds timeout);
+
+    /**
+     * @param timeout_ms Maximal time of waiting for the printer to take `data`, 0 for no limit
+     */
+    void send(std::vector<uint8_t>& data, unsigned timeout_ms = 0);
     PrinterStatus receive_status();
-    void send_job_data(const PrinterJobData& job_data);
-    void send_page_data(const Label& page_data, bool last_page);
+
+    /**
+     * Sends job data, page data and the print command of a page in one transfer.
+     */
+    void send_page(PageBuilder& builder, const JobHeader& header, std::vector<uint8_t> printing_data, bool last_page,
+            bool compress, unsigned timeout_ms = 0);
+
+    /**
+     * @return Whether `async_transfers` can be used - asynchronous transfers need libusb, so other
+     * transports are always used synchronously
+     */
+    [[nodiscard]] bool transfers_async() const noexcept;
+
+    void print_sync(PrintPipeline& pipeline, const PrinterJobData& job_data);
+    void print_async(PrintPipeline& pipeline, const PrinterJobData& job_data);
+    void print_windowed(PrintPipeline& pipeline, const PrinterJobData& job_data);
+
+    /**
+     * Receives statuses of a printed page - until the phase change which follows printing completed
+     * (or an error), other statuses in between are skipped.
+     *
+     * @param sent When the page was sent, the wait for it to be printed is measured from then
+     *
+     * @throws PrinterError if the printer reported an error
+     */
+    void receive_page_status(Metrics::Clock::time_point sent);
 
 public:
+    /**
+     * Default width of strips in `print_streaming()` - 256 columns of 62mm tape take
+     * about 700kB as RGB24 surface and 24kB of printing data.
+     */
+    static constexpr uint32_t DEFAULT_STRIP_COLUMNS = 256;
+
+    /**
+     * Maximal time a page sent ahead (see `set_send_ahead_window()`) waits for the printer to take it.
+     * The printer doesn't take pages while its buffer is full, so a jammed printer would block the job forever.
+     */
+    static constexpr unsigned SEND_TIMEOUT_MS = 30000;
+
     Printer();
+
+    /**
+     * Printer which uses given transport instead of a USB printer (for example `SimulatedPrinter`).
+     * Libusb is not initialized, so the printer can't be scanned for, opened or reconnected.
+     */
+    explicit Printer(std::unique_ptr<Transport> transport);
+
     ~Printer() noexcept;
 
+    /**
+     * Waits until a printer is connected and opens it. If libusb supports hotplug, hotplug events
+     * are enabled (see `enable_hotplug()`) and the printer is opened as soon as it appears - `scan_timeout`
+     * is then only the interval of "not found" messages. Otherwise the device list is polled every `scan_timeout` seconds.
+     */
     void scan_for_printer(uint8_t scan_timeout = 5);
 
+    /**
+     * Starts tracking connection of the printer with libusb hotplug events on a background thread:
+     * a printer which appears is noticed at once and a printer which leaves is marked as disconnected
+     * (see `is_connected()` and `reconnect()`).
+     *
+     * @return `false` if hotplug is not supported on this platform
+     *
+     * @throws USBError if hotplug callback can't be registered
+     */
+    bool enable_hotplug();
+
+    /**
+     * @return `true` if the printer is opened and (with hotplug enabled) it hasn't been unplugged since
+     */
+    [[nodiscard]] bool is_connected() noexcept;
+
+    /**
+     * Closes handle of a disconnected printer and opens the printer again once it appears - only the one
+     * at the same location if it was opened with `open(const PrinterLocation&)`. Jobs which failed because
+     * of the disconnection can be printed again afterwards.
+     *
+     * @param timeout Maximal time of waiting for the printer
+     * @return `true` if the printer is connected
+     *
+     * @throws USBError if the printer appeared, but it couldn't be opened
+     */
+    bool reconnect(std::chrono::milliseconds timeout);
+
+    /**
+     * @return Locations of all of the connected printers, sorted by location
+     *
+     * @throws USBError if the devices can't be listed
+     */
+    [[nodiscard]] static std::vector<PrinterLocation> find_printers();
+
+    /**
+     * Opens the printer at the given location (see `find_printers()`), so that each
+     * of several identical printers can have its own `Printer`.
+     *
+     * @throws USBError if there is no printer at `location` or it can't be opened
+     */
+    void open(const PrinterLocation& location);
+
+    /**
+     * @return Location of the opened printer
+     */
+    [[nodiscard]] const PrinterLocation& get_location() const noexcept;
+
     void clear_jobs();
     void init();
 
     PrinterStatus send_request_status();
+
+    /**
+     * Enables or disables asynchronous transfers in `print()`.
+     *
+     * With asynchronous transfers page data is handed over to `AsyncTransport` and
+     * the next page is rendered while the previous one is still being transferred.
+     * Next page is queued right after it is rendered, so up to two pages are in flight.
+     *
+     * @see AsyncTransport
+     */
+    void set_async_transfers(bool enabled) noexcept;
+
+    /**
+     * Sets options of the pipeline which prepares pages in `print()`.
+     *
+     * Labels are rendered and rasterized on worker threads while previous pages are
+     * being sent and printed.
+     *
+     * @see PrintPipeline
+     */
+    void set_pipeline_options(const PrintPipelineOptions& options) noexcept;
+
+    /**
+     * Sets number of pages which `print()` sends ahead, before the printer reports that they are printed.
+     *
+     * With window of 1 (default) every page is sent only after the previous one is printed, so the
+     * receive buffer of the printer runs empty and the motor stops between pages. With bigger window
+     * statuses are read by `StatusMonitor` in the background and following pages are sent while the
+     * current one is being printed, so labels of a multi-label job are fed continuously. Sending stops
+     * (and pending transfers are cancelled) as soon as the printer reports an error, and a page which
+     * the printer doesn't take within `SEND_TIMEOUT_MS` fails the job.
+     *
+     * @param pages Maximal number of sent, but not yet printed pages (0 is treated as 1)
+     *
+     * @see StatusMonitor
+     */
+    void set_send_ahead_window(size_t pages) noexcept;
+
+    /**
+     * Prints given labels as a single job.
+     *
+     * @param labels Labels to print, all of them must have the media format of the job
+     * @param job_data Job settings
+     *
+     * @throws std::invalid_argument if some label has different format than `job_data`
+     * @throws PrinterError if the printer reports an error while sending ahead
+     */
     void print(const std::vector<Label*>& labels, PrinterJobData job_data);
+
+    /**
+     * Prints labels of a source as a single job, taking them one at a time while the job is being printed.
+     *
+     * Only labels in flight of the pipeline (see `PrintPipelineOptions::max_in_flight`) are held at once,
+     * so jobs of any number of labels print in constant memory, and the first label is printed before
+     * the source runs out. The last page is known only once the source returns `nullptr`, so it may
+     * be sent after the source yields the label following it.
+     *
+     * @param labels Source of labels to print, all of them must have the media format of the job
+     * @param job_data Job settings
+     *
+     * @throws std::invalid_argument if some label has different format than `job_data`, labels before it
+     * are printed already
+     * @throws PrinterError if the printer reports an error while sending ahead
+     * @throws Any exception thrown by `labels`
+     */
+    void print(LabelSource labels, PrinterJobData job_data);
+
+    /**
+     * Prints a single label as a single job, rendering, rasterizing and sending it strip by strip
+     * (see `Label::render_strips()`). Only a few strips are in memory at once, no matter how long
+     * the label is, and data is sent to the printer as soon as the first strip is ready - which
+     * matters for long continuous length labels (up to 1m, which is almost 12000 columns).
+     *
+     * With asynchronous transfers the next strip is rendered while the previous ones are being transferred.
+     *
+     * @param label Label to print, it must have the media format of the job
+     * @param job_data Job settings
+     * @param strip_columns Number of columns rendered at once
+     *
+     * @throws std::invalid_argument if the label has different format than `job_data`, it can't be
+     * rendered in strips or `strip_columns` is 0
+     */
+    void print_streaming(const Label& label, PrinterJobData job_data, uint32_t strip_columns = DEFAULT_STRIP_COLUMNS);
+
+    /**
+     * @return Statistics of the last (or current) print job
+     */
+    [[nodiscard]] const PrinterJobStatistics& get_job_statistics() const noexcept;
 };
 
 
@@ -1,12 +1,28 @@
 #include <cmath>
 #include "PrinterJobData.h"
 
-PrinterJobData::PrinterJobData() {
-    if(!Label::is_valid())
+namespace {
+    // Layout of the job header is checked at compile time
+    constexpr JobHeader example_header(CommandBuffer<JobHeader::CAPACITY> {}
+            .append(EscpCommands::print_information(true, LabelType::DIE_CUT, 29, 90, 991, true)));
+    static_assert(example_header.size() == 13 && example_header.data()[EscpCommands::STARTING_PAGE_OFFSET] == 0x00);
+    static_assert(example_header.data()[7] == (991 & 0xff) && example_header.data()[8] == (991 >> 8));
+    static_assert(EscpCommands::print_information(false, LabelType::CONTINUOUS_LENGTH, 62, 0, 1, false)
+            [EscpCommands::STARTING_PAGE_OFFSET] == 0x01);
+}
+
+size_t PrinterJobStatistics::bytes_saved() const noexcept {
+    return raster_bytes - sent_bytes;
+}
+
+PrinterJobData::PrinterJobData() : PrinterJobData(Label::get_default_format()) {}
+
+PrinterJobData::PrinterJobData(const LabelFormat& _format) : format(_format) {
+    if(!format.is_valid())
         throw std::runtime_error("Label type not set! Use provided static function to set it");
 
-    label_type = Label::get_type();
-    const LabelDimensions dimensions = Label::get_dimensions();
+    label_type = format.type;
+    const LabelDimensions& dimensions = format.dimensions;
     label_width = label_type == LabelType::DIE_CUT ? dimensions.width_mm : 0;
     label_height = dimensions.height_mm;
     raster_number = dimensions.width_pt;
@@ -16,6 +32,11 @@ PrinterJobData::PrinterJobData() {
     cut_at_end = true;
     high_quality = false;
     margin_amount = label_type == LabelType::DIE_CUT ? 0 : 35;
+    compression = false;
+}
+
+const LabelFormat& PrinterJobData::get_format() const noexcept {
+    return format;
 }
 
 void PrinterJobData::set_is_starting_page(const bool _starting_page) noexcept {
@@ -46,55 +67,50 @@ void PrinterJobData::set_margin_amount(const uint8_t margin_amount_mm) {
     margin_amount = std::round(margin_amount_mm * 0.03937 * 300);
 }
 
+void PrinterJobData::set_compression(const bool _compression) noexcept {
+    compression = _compression;
+}
+
+bool PrinterJobData::is_compressed() const noexcept {
+    return compression;
+}
+
 std::vector<uint8_t> PrinterJobData::construct_job_data_message() const noexcept {
     std::vector<uint8_t> job_data {};
+    construct_job_data_message(job_data);
+    return job_data;
+}
+
+void PrinterJobData::construct_job_data_message(std::vector<uint8_t>& job_data) const {
+    const JobHeader header = construct_job_header();
+    job_data.assign(header.data(), header.data() + header.size());
+}
+
+JobHeader PrinterJobData::construct_job_header() const noexcept {
+    CommandBuffer<JobHeader::CAPACITY> commands {};
+    const uint8_t quality = high_quality ? 0xce : 0x8e;
 
     /* Set print information */
-    std::array<uint8_t, 13> set_print_information {
-        0x1b, 0x69, 0x7a,
-        static_cast<uint8_t>((high_quality ? 0xce : 0x8e)),
-        static_cast<uint8_t>((label_type == LabelType::DIE_CUT ? 0x0b : 0x0a)),
-        label_height, label_width,
-        static_cast<uint8_t>(raster_number & 0xffu),
-        static_cast<uint8_t>((raster_number >> 8u) & 0xffu),
-        static_cast<uint8_t>((raster_number >> 16u) & 0xffu),
-        static_cast<uint8_t>((raster_number >> 24u) & 0xffu),
-        static_cast<uint8_t>(starting_page ? 0x00 : 0x01),
-        0x00
-    };
-    job_data.insert(job_data.end(), set_print_information.begin(), set_print_information.end());
-    job_data.insert(job_data.end(), {0x00, 0x01, static_cast<unsigned char>(high_quality ? 0xce : 0x8e)});
+    commands.append(EscpCommands::print_information(high_quality, label_type, label_height, label_width,
+            raster_number, starting_page));
+    commands.append(std::array<uint8_t, 3> {0x00, 0x01, quality});
 
     /* Set auto cut */
-    std::array<uint8_t, 4> set_auto_cut_mode {
-        0x1b, 0x69, 0x4d,
-        static_cast<uint8_t>(cut_every_x_labels ? 0x40 : 0x00)
-    };
-    job_data.insert(job_data.end(), set_auto_cut_mode.begin(), set_auto_cut_mode.end());
+    commands.append(EscpCommands::various_mode(cut_every_x_labels.has_value()));
 
     /* Set cut every x labels option */
-    if(cut_every_x_labels) {
-        std::array<uint8_t, 4> set_cut_every_opt{
-            0x1b, 0x69, 0x41,
-            cut_every_x_labels.value()
-        };
-        job_data.insert(job_data.end(), set_cut_every_opt.begin(), set_cut_every_opt.end());
-    }
+    if(cut_every_x_labels)
+        commands.append(EscpCommands::cut_every(cut_every_x_labels.value()));
 
     /* Set expanded mode (cut at end) */
-    std::array<uint8_t, 4> set_exp_mode {
-        0x1b, 0x69, 0x4b,
-        static_cast<uint8_t>(cut_at_end << 3u)
-    };
-    job_data.insert(job_data.end(), set_exp_mode.begin(), set_exp_mode.end());
+    commands.append(EscpCommands::expanded_mode(cut_at_end));
 
     /* Set margin amount */
-    std::array<uint8_t, 5> set_margin {
-        0x1b, 0x69, 0x64,
-        static_cast<uint8_t>(margin_amount & 0xffu),
-        static_cast<uint8_t>((margin_amount >> 8u) & 0xffu)
-    };
-    job_data.insert(job_data.end(), set_margin.begin(), set_margin.end());
+    commands.append(EscpCommands::margin_amount(margin_amount));
 
-    return job_data;
+    /* Set compression mode (TIFF) */
+    if(compression)
+        commands.append(EscpCommands::compression_mode());
+
+    return JobHeader(commands);
 }
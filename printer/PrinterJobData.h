@@ -2,6 +2,18 @@
 #define LABEL_PRINTER_DRIVER_PRINTERJOBDATA_H
 
 #include "../label/Label.h"
+#include "EscpCommands.h"
+
+/**
+ * Statistics of a single print job.
+ */
+struct PrinterJobStatistics {
+    size_t pages = 0;
+    size_t raster_bytes = 0;  /**< Size of page data before compression */
+    size_t sent_bytes = 0;  /**< Size of page data actually sent to the printer */
+
+    [[nodiscard]] size_t bytes_saved() const noexcept;
+};
 
 /**
  * Representation of a job data message that is sent
@@ -9,6 +21,8 @@
  */
 class PrinterJobData {
 private:
+    LabelFormat format;  /**< Media format of all labels in the job */
+
     LabelType label_type;
     uint8_t label_width;  /**< Width of the label in millimeters */
     uint8_t label_height;  /**< Height of the label in millimeters */
@@ -23,18 +37,32 @@ private:
 
     uint16_t margin_amount;
 
+    bool compression;  /**< Send raster data compressed with PackBits */
+
 public:
 
     /**
      * Default constructor that sets label properties according to
-     * values of `Label::dimensions` and `Label::type` and the rest of
-     * the class members is set to somewhat arbitrary default values.
+     * `Label::get_default_format()`.
      *
      * @throws std::runtime_error if `Label::is_valid()` returns `false`
-     * @see Label
+     * @see PrinterJobData(const LabelFormat&)
      */
     PrinterJobData();
 
+    /**
+     * Sets label properties according to `format` and the rest of
+     * the class members to somewhat arbitrary default values.
+     *
+     * @param format Media format of the job
+     *
+     * @throws std::runtime_error if `format` is not valid
+     * @see LabelFormat
+     */
+    explicit PrinterJobData(const LabelFormat& format);
+
+    [[nodiscard]] const LabelFormat& get_format() const noexcept;
+
     void set_is_starting_page(bool starting_page) noexcept;
 
     /**
@@ -61,12 +89,33 @@ public:
      */
     void set_margin_amount(uint8_t margin_amount_mm);
 
+    /**
+     * Enables or disables compressed (PackBits) transfer of raster data.
+     *
+     * @see PackBits
+     */
+    void set_compression(bool compression) noexcept;
+    [[nodiscard]] bool is_compressed() const noexcept;
+
     /**
      * Constructs job data message from member values.
      *
      * @return Vector of bytes that represents job data packet
      */
     [[nodiscard]] std::vector<uint8_t> construct_job_data_message() const noexcept;
+
+    /**
+     * Same as above, but writes the message into `job_data` (its contents are replaced).
+     */
+    void construct_job_data_message(std::vector<uint8_t>& job_data) const;
+
+    /**
+     * Constructs job data message without allocation. Pages of a job differ only in the starting
+     * page flag, so the header can be built once per job and patched with `JobHeader::set_starting_page()`.
+     *
+     * @return Same bytes as `construct_job_data_message()`
+     */
+    [[nodiscard]] JobHeader construct_job_header() const noexcept;
 };
 
 
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+
+#include "PrinterPool.h"
+
+PrinterPool::PrinterPool(const std::vector<PrinterLocation>& locations, const std::function<void(Printer&)>& setup)
+    : PrinterPool(open_printers(locations, setup)) {}
+
+PrinterPool::PrinterPool(std::vector<std::unique_ptr<Printer>> printers) {
+    if(printers.empty())
+        throw std::invalid_argument("Printer pool needs at least one printer");
+
+    for(auto& printer: printers) {
+        auto station = std::make_unique<Station>();
+        station->printer = std::move(printer);
+        stations.push_back(std::move(station));
+    }
+
+    for(auto& station: stations)
+        station->worker = std::thread(&PrinterPool::work, this, std::ref(*station));
+}
+
+std::vector<std::unique_ptr<Printer>> PrinterPool::open_printers(const std::vector<PrinterLocation>& locations,
+        const std::function<void(Printer&)>& setup) {
+    std::vector<std::unique_ptr<Printer>> printers {};
+    for(const auto& location: locations) {
+        auto printer = std::make_unique<Printer>();
+        printer->open(location);
+        printer->enable_hotplug();
+        if(setup)
+            setup(*printer);
+        printers.push_back(std::move(printer));
+    }
+    return printers;
+}
+
+PrinterPool::~PrinterPool() noexcept {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    for(auto& station: stations) {
+        station->job_available.notify_all();
+        station->worker.join();
+    }
+}
+
+void PrinterPool::work(Station& station) noexcept {
+    while(true) {
+        std::unique_lock lock(mutex);
+        station.job_available.wait(lock, [&] { return stopping || !station.jobs.empty(); });
+        if(station.jobs.empty())
+            return;
+
+        QueuedJob queued = std::move(station.jobs.front());
+        station.jobs.pop_front();
+        lock.unlock();
+        const PoolJob& job = queued.job;
+
+        const auto start = Clock::now();
+        try {
+            station.printer->print(job.labels, job.job_data);
+            queued.promise.set_value(station.printer->get_job_statistics());
+        }
+        catch(...) {
+            const bool connected = station.printer->is_connected();
+            if(!connected && wait_for_reconnect(station)) {
+                // Printed again from the start, before the rest of the queue
+                lock.lock();
+                station.consecutive_failures = 0;
+                station.backoff_until = {};
+                station.jobs.push_front(std::move(queued));
+                continue;
+            }
+
+            lock.lock();
+            station.queued_labels -= job.labels.size();
+            if(connected) {
+                count_failure(station);
+
+                // Printers which are still working get their turn (threads of stopping pool may be gone already)
+                if(++queued.failures < stations.size() && !stopping) {
+                    Station& other = enqueue(std::move(queued), &station);
+                    lock.unlock();
+                    other.job_available.notify_one();
+                    continue;
+                }
+            }
+            lock.unlock();
+
+            queued.promise.set_exception(std::current_exception());
+            continue;
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        lock.lock();
+        station.queued_labels -= job.labels.size();
+        station.consecutive_failures = 0;
+        station.backoff_until = {};
+
+        if(!job.labels.empty() && elapsed.count() > 0) {
+            const double labels_per_second = job.labels.size() / elapsed.count();
+            station.labels_per_second = station.labels_per_second == 0 ? labels_per_second
+                    : station.labels_per_second + THROUGHPUT_SMOOTHING * (labels_per_second - station.labels_per_second);
+        }
+    }
+}
+
+bool PrinterPool::wait_for_reconnect(Station& station) noexcept {
+    while(true) {
+        {
+            std::lock_guard lock(mutex);
+            if(stopping)
+                return false;
+        }
+
+        try {
+            if(station.printer->reconnect(RECONNECT_INTERVAL))
+                return true;
+        }
+        catch(const USBError&) {
+            // Printer appeared, but isn't ready yet - try again with its next arrival
+        }
+    }
+}
+
+PrinterPool::Station& PrinterPool::enqueue(QueuedJob job, const Station *failed) {
+    Station& station = *stations[choose(job.job, failed)];
+    station.queued_labels += job.job.labels.size();
+    station.jobs.push_back(std::move(job));
+    return station;
+}
+
+void PrinterPool::count_failure(Station& station) {
+    ++station.consecutive_failures;
+
+    std::chrono::milliseconds backoff = FAILURE_BACKOFF;
+    for(size_t i = 1; i < station.consecutive_failures && backoff < MAX_FAILURE_BACKOFF; ++i)
+        backoff *= 2;
+    station.backoff_until = Clock::now() + std::min(backoff, MAX_FAILURE_BACKOFF);
+}
+
+size_t PrinterPool::choose(const PoolJob& job, const Station *failed) const {
+    if(failed == nullptr && !job.affinity.empty()) {
+        const auto it = affinities.find(job.affinity);
+        if(it != affinities.end())
+            return it->second;
+    }
+
+    // Printers which haven't printed anything yet are assumed to be as fast as the others
+    double known_throughput = 0;
+    size_t known = 0;
+    for(const auto& station: stations) {
+        if(station->labels_per_second > 0) {
+            known_throughput += station->labels_per_second;
+            ++known;
+        }
+    }
+    const double default_throughput = known > 0 ? known_throughput / known : 1;
+
+    // Printers which are backing off are only chosen if all of them are
+    const auto now = Clock::now();
+    std::optional<size_t> chosen {};
+    bool chosen_ready = false;
+    double chosen_time = 0;
+    for(size_t i = 0; i < stations.size(); ++i) {
+        const Station& station = *stations[i];
+        if(&station == failed)
+            continue;
+
+        const bool ready = now >= station.backoff_until;
+        const double throughput = station.labels_per_second > 0 ? station.labels_per_second : default_throughput;
+        const double time = (station.queued_labels + job.labels.size()) / throughput;
+
+        if(!chosen || (ready && !chosen_ready) || (ready == chosen_ready && time < chosen_time)) {
+            chosen = i;
+            chosen_ready = ready;
+            chosen_time = time;
+        }
+    }
+
+    return chosen.value_or(0);
+}
+
+std::future<PrinterJobStatistics> PrinterPool::submit(PoolJob job) {
+    std::promise<PrinterJobStatistics> promise {};
+    std::future<PrinterJobStatistics> result = promise.get_future();
+
+    Station *station;
+    {
+        std::lock_guard lock(mutex);
+        station = &enqueue({std::move(job), std::move(promise)});
+    }
+    station->job_available.notify_one();
+
+    return result;
+}
+
+void PrinterPool::set_affinity(const std::string& affinity, const size_t printer) {
+    if(printer >= stations.size())
+        throw std::out_of_range("No printer with index " + std::to_string(printer) + " in the pool");
+
+    std::lock_guard lock(mutex);
+    affinities[affinity] = printer;
+}
+
+void PrinterPool::clear_affinity(const std::string& affinity) {
+    std::lock_guard lock(mutex);
+    affinities.erase(affinity);
+}
+
+size_t PrinterPool::get_printer_count() const noexcept {
+    return stations.size();
+}
+
+std::vector<PooledPrinterStatus> PrinterPool::get_status() const {
+    std::lock_guard lock(mutex);
+
+    std::vector<PooledPrinterStatus> status {};
+    for(const auto& station: stations)
+        status.push_back({station->printer->get_location(), station->queued_labels, station->labels_per_second,
+                station->consecutive_failures});
+    return status;
+}
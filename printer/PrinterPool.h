@@ -0,0 +1,180 @@
+#ifndef LABEL_PRINTER_DRIVER_PRINTERPOOL_H
+#define LABEL_PRINTER_DRIVER_PRINTERPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Printer.h"
+
+/**
+ * Print job submitted to `PrinterPool`.
+ */
+struct PoolJob {
+    std::vector<Label*> labels;  /**< Labels must stay alive until the job is finished */
+    PrinterJobData job_data;
+    std::string affinity;  /**< Product or station whose jobs should go to one printer (optional) */
+};
+
+/**
+ * Current load of one printer of a `PrinterPool`.
+ */
+struct PooledPrinterStatus {
+    PrinterLocation location;
+    size_t queued_labels;  /**< Labels of queued jobs and of the job being printed */
+    double labels_per_second;  /**< Throughput of recent jobs, 0 until the first job is printed */
+    size_t consecutive_failures;  /**< Jobs which failed since the last printed one or reconnection */
+};
+
+/**
+ * Several printers attached to one host, each with its own `Printer` session and its
+ * own thread, so they print at the same time.
+ *
+ * Jobs are dispatched to the printer which is expected to finish them first - the one
+ * with the fewest queued labels relative to its recent throughput (idle printers first).
+ * Jobs with an affinity which is bound to a printer (see `set_affinity()`) always go to that printer.
+ *
+ * A printer which is unplugged keeps its queue: the interrupted job and the queued ones are printed
+ * once it is plugged into the same port again (or fail when the pool is destroyed in the meantime).
+ *
+ * A job which fails on a connected printer (for example because it ran out of media) is queued on
+ * another printer, until it has failed on as many printers as there are in the pool. The failing
+ * printer backs off - it isn't chosen for new jobs (unless all of the printers are backing off) for
+ * `FAILURE_BACKOFF`, doubled with each consecutive failure, until it prints a job or is reconnected.
+ */
+class PrinterPool {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QueuedJob {
+        PoolJob job;
+        std::promise<PrinterJobStatistics> promise;
+        size_t failures = 0;  /**< Printers on which the job failed */
+    };
+
+    struct Station {
+        std::unique_ptr<Printer> printer;
+        std::deque<QueuedJob> jobs;
+        std::condition_variable job_available;
+
+        size_t queued_labels = 0;
+        double labels_per_second = 0;
+        size_t consecutive_failures = 0;
+        Clock::time_point backoff_until {};
+
+        std::thread worker;
+    };
+
+    std::vector<std::unique_ptr<Station>> stations;
+    std::map<std::string, size_t> affinities;
+    bool stopping = false;
+
+    mutable std::mutex mutex;
+
+    static std::vector<std::unique_ptr<Printer>> open_printers(const std::vector<PrinterLocation>& locations,
+            const std::function<void(Printer&)>& setup);
+
+    void work(Station& station) noexcept;
+
+    /**
+     * Queues `job` on the chosen printer (called with `mutex` locked).
+     *
+     * @param failed Printer on which the job has just failed, it isn't chosen again
+     * @return The chosen printer, which should be notified
+     */
+    Station& enqueue(QueuedJob job, const Station *failed = nullptr);
+
+    /**
+     * Counts failure of a job on `station` and starts its back-off (called with `mutex` locked).
+     */
+    void count_failure(Station& station);
+
+    /**
+     * Waits until the disconnected printer of `station` is connected again.
+     *
+     * @return `false` if the pool is stopping
+     */
+    bool wait_for_reconnect(Station& station) noexcept;
+
+    /**
+     * @param failed Printer which is never chosen, affinity of the job is ignored then
+     * @return Index of the printer which should print `job` (called with `mutex` locked)
+     */
+    [[nodiscard]] size_t choose(const PoolJob& job, const Station *failed = nullptr) const;
+
+public:
+    /**
+     * Weight of the last job in the moving average of throughput.
+     */
+    static constexpr double THROUGHPUT_SMOOTHING = 0.3;
+
+    /**
+     * Interval of checking whether the pool is stopping while a printer is disconnected.
+     */
+    static constexpr std::chrono::milliseconds RECONNECT_INTERVAL {1000};
+
+    /**
+     * Back-off of a printer after its first failed job, doubled with each consecutive failure up
+     * to `MAX_FAILURE_BACKOFF`.
+     */
+    static constexpr std::chrono::milliseconds FAILURE_BACKOFF {5000};
+    static constexpr std::chrono::milliseconds MAX_FAILURE_BACKOFF {120000};
+
+    /**
+     * Opens printers at given locations and starts their threads.
+     *
+     * @param locations Printers of the pool, all of the connected printers by default
+     * @param setup Called for each opened printer before it prints anything (for example
+     * to set pipeline options or asynchronous transfers)
+     *
+     * @throws std::invalid_argument if `locations` is empty
+     * @throws USBError if some of the printers can't be opened
+     */
+    explicit PrinterPool(const std::vector<PrinterLocation>& locations = Printer::find_printers(),
+            const std::function<void(Printer&)>& setup = {});
+
+    /**
+     * Starts threads of printers which are already set up (for example over `SimulatedPrinter`).
+     *
+     * @throws std::invalid_argument if `printers` is empty
+     */
+    explicit PrinterPool(std::vector<std::unique_ptr<Printer>> printers);
+
+    /**
+     * Finishes all of the queued jobs and joins printer threads.
+     */
+    ~PrinterPool() noexcept;
+
+    PrinterPool(const PrinterPool&) = delete;
+    PrinterPool& operator=(const PrinterPool&) = delete;
+
+    /**
+     * Queues the job on one of the printers.
+     *
+     * @return Statistics of the job once it is printed, or the exception thrown by `Printer::print()`
+     * on the last printer the job was tried on
+     */
+    [[nodiscard]] std::future<PrinterJobStatistics> submit(PoolJob job);
+
+    /**
+     * Sends all of the following jobs with given affinity to the printer with index `printer`.
+     *
+     * @throws std::out_of_range if there is no such printer
+     */
+    void set_affinity(const std::string& affinity, size_t printer);
+    void clear_affinity(const std::string& affinity);
+
+    [[nodiscard]] size_t get_printer_count() const noexcept;
+    [[nodiscard]] std::vector<PooledPrinterStatus> get_status() const;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_PRINTERPOOL_H
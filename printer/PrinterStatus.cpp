@@ -1,10 +1,8 @@
 #include "PrinterStatus.h"
 #include "../exceptions/PrinterError.h"
 
-#include <iostream>
 #include <iomanip>
-
-using std::cout, std::endl;
+#include <sstream>
 
 const std::map<ErrorType, std::string> PrinterStatus::error_type_codes {
         {ErrorType::NO_ERROR, "No error"},
@@ -51,32 +49,38 @@ PrinterStatus::PrinterStatus(const std::array<uint8_t, 32> &printer_status) noex
     media_length { printer_status[MEDIA_LENGTH_OFFSET] },
     media_width { printer_status[MEDIA_WIDTH_OFFSET] } {}
 
-void PrinterStatus::display() const noexcept {
-    cout << endl << "--- Printer Status ---" << endl;
-    cout << std::left << std::setfill(' ');
+void PrinterStatus::display(const LogLevel level) const noexcept {
+    if(!Logger::enabled(level))
+        return;
+
+    std::ostringstream out {};
+    out << "--- Printer Status ---" << '\n';
+    out << std::left << std::setfill(' ');
 
     // Error
     const auto& err_it = error_type_codes.find((ErrorType) error_code);
-    cout << std::setw(20) << "Error:" << (err_it == error_type_codes.end() ? "UNKNOWN" : err_it->second) << endl;
+    out << std::setw(20) << "Error:" << (err_it == error_type_codes.end() ? "UNKNOWN" : err_it->second) << '\n';
 
     // Media type
     const auto& med_it = media_type_codes.find((MediaType) media_code);
-    cout << std::setw(20) << "Media type:" << (med_it == media_type_codes.end() ? "UNKNOWN" : med_it->second) << endl;
+    out << std::setw(20) << "Media type:" << (med_it == media_type_codes.end() ? "UNKNOWN" : med_it->second) << '\n';
 
     // Status
     const auto& st_it = status_type_codes.find((StatusType) status_code);
-    cout << std::setw(20) << "Status:" << (st_it == status_type_codes.end() ? "UNKNOWN" : st_it->second) << endl;
+    out << std::setw(20) << "Status:" << (st_it == status_type_codes.end() ? "UNKNOWN" : st_it->second) << '\n';
 
     // Phase
     const auto& ph_it = phase_type_codes.find((PhaseType) phase_code);
-    cout << std::setw(20) << "Phase:" << (ph_it == phase_type_codes.end() ? "UNKNOWN" : ph_it->second) << endl;
+    out << std::setw(20) << "Phase:" << (ph_it == phase_type_codes.end() ? "UNKNOWN" : ph_it->second) << '\n';
 
     // Notification
     const auto& not_it = notification_type_codes.find((NotificationType) notification_code);
-    cout << std::setw(20) << "Notification:" << (not_it == notification_type_codes.end() ? "UNKNOWN" : not_it->second) << endl;
+    out << std::setw(20) << "Notification:" << (not_it == notification_type_codes.end() ? "UNKNOWN" : not_it->second) << '\n';
 
     // Media dimensions
-    cout << std::setw(20) << "Media dimensions:" << "[" << (unsigned) media_width << " x " << (unsigned) media_length << "]" << endl << endl;
+    out << std::setw(20) << "Media dimensions:" << "[" << (unsigned) media_width << " x " << (unsigned) media_length << "]";
+
+    Logger::log(level, out.str());
 }
 
 bool PrinterStatus::check_error() const noexcept {
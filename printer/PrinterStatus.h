@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <map>
 
+#include "../utils/Logger.h"
+
 
 enum class ErrorType : uint16_t {
     NO_ERROR = 0x0000,
@@ -68,7 +70,10 @@ struct PrinterStatus {
 
     explicit PrinterStatus(const std::array<uint8_t, 32>& printer_status) noexcept;
 
-    void display() const noexcept;
+    /**
+     * Logs the status in a human readable form (the status isn't even formatted if `level` is disabled).
+     */
+    void display(LogLevel level = LogLevel::INFO) const noexcept;
     [[nodiscard]] inline bool check_error() const noexcept;
     void check_error_throw() const;
 };
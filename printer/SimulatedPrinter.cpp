@@ -0,0 +1,252 @@
+#include <algorithm>
+
+#include "SimulatedPrinter.h"
+#include "../exceptions/USBError.h"
+
+namespace {
+    constexpr double DOTS_PER_MM = 300 / 25.4;
+}
+
+SimulatedPrinter::SimulatedPrinter(SimulatedPrinterOptions _options)
+    : options(std::move(_options)) {
+    replies.reserve(REPLY_CAPACITY);
+    page_finishes.reserve(std::max<size_t>(options.receive_buffer_pages, 1) + 1);
+}
+
+size_t SimulatedPrinter::send(const uint8_t *data, const size_t length, const unsigned timeout_ms) {
+    std::unique_lock lock(mutex);
+    statistics.received_bytes += length;
+    pending.insert(pending.end(), data, data + length);
+    send_deadline = timeout_ms > 0 ? std::optional(Clock::now() + std::chrono::milliseconds(timeout_ms)) : std::nullopt;
+
+    size_t offset = 0;
+    try {
+        while(offset < pending.size()) {
+            const size_t size = handle_command(pending.data() + offset, pending.size() - offset, lock);
+            if(size == 0)
+                break;
+            offset += size;
+        }
+    }
+    catch(...) {
+        // Rest of the timed out transfer is never taken
+        pending.clear();
+        throw;
+    }
+    pending.erase(pending.begin(), pending.begin() + offset);
+
+    return length;
+}
+
+size_t SimulatedPrinter::handle_command(const uint8_t *data, const size_t size, std::unique_lock<std::mutex>& lock) {
+    switch(data[0]) {
+        case 0x00:  // Invalidate
+            return 1;
+
+        case 0x1b:
+            if(size < 2)
+                return 0;
+            if(data[1] == 0x40) {  // Initialize
+                failed = failed && options.persistent_error;
+                compression = false;
+                page_raster.clear();
+                return 2;
+            }
+            if(data[1] != 0x69) {
+                ++statistics.ignored_bytes;
+                return 1;
+            }
+            if(size < 3)
+                return 0;
+
+            switch(data[2]) {
+                case 0x53: {  // Status information request
+                    const auto now = Clock::now();
+                    ++statistics.status_requests;
+                    reply(now, StatusType::REPLY_TO_STATUS_REQUEST,
+                            busy_until > now ? PhaseType::PRINTING_STATE : PhaseType::WAITING_TO_RECEIVE,
+                            failed ? options.error : ErrorType::NO_ERROR);
+                    return 3;
+                }
+                case 0x7a:  // Print information
+                    return size < 13 ? 0 : 13;
+                case 0x64:  // Margin amount
+                    return size < 5 ? 0 : 5;
+                case 0x41:  // Cut every x labels
+                case 0x4b:  // Expanded mode
+                case 0x4d:  // Various mode
+                case 0x61:  // Command mode
+                    return size < 4 ? 0 : 4;
+                default:
+                    ++statistics.ignored_bytes;
+                    return 1;
+            }
+
+        case 0x4d:  // Compression mode
+            if(size < 2)
+                return 0;
+            compression = data[1] == 0x02;
+            return 2;
+
+        case 0x67: {  // Raster line
+            if(size < 3 || size < 3u + data[2])
+                return 0;
+            add_raster_line(data + 3, data[2]);
+            return 3u + data[2];
+        }
+
+        case 0x5a:  // Zero raster line
+            add_raster_line(nullptr, 0);
+            return 1;
+
+        case 0x0c:  // Print
+        case 0x1a:  // Print with feeding
+            print_page(lock);
+            return 1;
+
+        default:
+            ++statistics.ignored_bytes;
+            return 1;
+    }
+}
+
+void SimulatedPrinter::add_raster_line(const uint8_t *data, const size_t size) {
+    const size_t start = page_raster.size();
+    ++statistics.raster_lines;
+
+    if(!compression)
+        page_raster.insert(page_raster.end(), data, data + size);
+    else {
+        // PackBits: n + 1 literal bytes for n >= 0, 1 - n copies of the next byte for n < 0
+        for(size_t i = 0; i < size;) {
+            const auto n = static_cast<int8_t>(data[i++]);
+            if(n >= 0) {
+                const size_t count = std::min<size_t>(n + 1, size - i);
+                page_raster.insert(page_raster.end(), data + i, data + i + count);
+                i += count;
+            }
+            else if(n != -128 && i < size)
+                page_raster.insert(page_raster.end(), 1 - n, data[i++]);
+        }
+    }
+
+    page_raster.resize(start + RASTER_LINE_SIZE, 0x00);
+}
+
+void SimulatedPrinter::print_page(std::unique_lock<std::mutex>& lock) {
+    if(failed) {
+        const auto now = Clock::now();
+        ++statistics.rejected_pages;
+        reply(now, StatusType::ERROR_OCCURRED, PhaseType::WAITING_TO_RECEIVE, options.error);
+        reply(now, StatusType::PHASE_CHANGE, PhaseType::WAITING_TO_RECEIVE, options.error);
+        page_raster.clear();
+        return;
+    }
+
+    // Received pages wait in the buffer until the printer gets to them
+    while(true) {
+        const auto now = Clock::now();
+        while(!page_finishes.empty() && page_finishes.front() <= now)
+            page_finishes.erase(page_finishes.begin());
+        if(page_finishes.size() < std::max<size_t>(options.receive_buffer_pages, 1))
+            break;
+
+        if(send_deadline && now >= *send_deadline) {
+            page_raster.clear();
+            throw USBError("LIBUSB_ERROR_TIMEOUT", "sending data");
+        }
+        reply_ready.wait_until(lock, send_deadline ? std::min(*send_deadline, page_finishes.front())
+                : page_finishes.front());
+    }
+
+    const auto start = std::max(Clock::now(), busy_until);
+    if(++received_pages == options.error_at_page) {
+        failed = true;
+        ++statistics.errors;
+        reply(start, StatusType::ERROR_OCCURRED, PhaseType::WAITING_TO_RECEIVE, options.error);
+        reply(start, StatusType::PHASE_CHANGE, PhaseType::WAITING_TO_RECEIVE, options.error);
+        busy_until = start;
+        page_raster.clear();
+        return;
+    }
+
+    const double length_mm = static_cast<double>(page_raster.size() / RASTER_LINE_SIZE) / DOTS_PER_MM;
+    const auto finish = start + scaled(std::chrono::duration<double>(length_mm / options.print_speed_mm_per_s))
+            + scaled(options.page_overhead);
+
+    ++statistics.pages;
+    reply(finish, StatusType::PRINTING_COMPLETED, PhaseType::PRINTING_STATE);
+    reply(finish, StatusType::PHASE_CHANGE, PhaseType::WAITING_TO_RECEIVE);
+    page_finishes.push_back(finish);
+    busy_until = finish;
+
+    if(options.cooling_after_pages > 0 && statistics.pages % options.cooling_after_pages == 0) {
+        ++statistics.cooling_periods;
+        busy_until = finish + scaled(options.cooling_time);
+        reply(finish, StatusType::NOTIFICATION, PhaseType::WAITING_TO_RECEIVE, ErrorType::NO_ERROR,
+                NotificationType::COOLING_START);
+        reply(busy_until, StatusType::NOTIFICATION, PhaseType::WAITING_TO_RECEIVE, ErrorType::NO_ERROR,
+                NotificationType::COOLING_FINISH);
+    }
+
+    last_page_raster.swap(page_raster);
+    page_raster.clear();
+}
+
+void SimulatedPrinter::reply(const Clock::time_point time, const StatusType status, const PhaseType phase,
+        const ErrorType error, const NotificationType notification) {
+    Packet packet {0x80, 0x20, 0x42, 0x34, 0x35, 0x30};  // Fixed header of status messages
+    packet[PrinterStatus::ERROR_TYPE_OFFSET] = static_cast<uint16_t>(error) >> 8u;
+    packet[PrinterStatus::ERROR_TYPE_OFFSET + 1] = static_cast<uint16_t>(error) & 0xffu;
+    packet[PrinterStatus::MEDIA_WIDTH_OFFSET] = options.media_width_mm;
+    packet[PrinterStatus::MEDIA_TYPE_OFFSET] = static_cast<uint8_t>(options.media_type);
+    packet[PrinterStatus::MEDIA_LENGTH_OFFSET] = options.media_length_mm;
+    packet[PrinterStatus::STATUS_TYPE_OFFSET] = static_cast<uint8_t>(status);
+    packet[PrinterStatus::PHASE_TYPE_OFFSET] = static_cast<uint8_t>(phase);
+    packet[PrinterStatus::NOTIFICATION_TYPE_OFFSET] = static_cast<uint8_t>(notification);
+
+    // Replies are kept in order of time, answers to status requests can overtake pages being printed
+    const auto position = std::upper_bound(replies.begin(), replies.end(), time,
+            [](const Clock::time_point t, const Reply& r) { return t < r.time; });
+    replies.insert(position, {time, packet});
+
+    reply_ready.notify_all();
+}
+
+size_t SimulatedPrinter::receive(uint8_t *buffer, const size_t length, const unsigned timeout_ms) {
+    std::unique_lock lock(mutex);
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while(true) {
+        const auto now = Clock::now();
+        if(!replies.empty() && replies.front().time <= now) {
+            const size_t size = std::min(length, replies.front().packet.size());
+            std::copy_n(replies.front().packet.begin(), size, buffer);
+            replies.erase(replies.begin());
+            return size;
+        }
+        if(timeout_ms > 0 && now >= deadline)
+            return 0;
+
+        if(!replies.empty())
+            reply_ready.wait_until(lock, timeout_ms > 0 ? std::min(deadline, replies.front().time) : replies.front().time);
+        else if(timeout_ms > 0)
+            reply_ready.wait_until(lock, deadline);
+        else
+            reply_ready.wait(lock);
+    }
+}
+
+SimulatedPrinter::Clock::duration SimulatedPrinter::scaled(const std::chrono::duration<double> duration) const noexcept {
+    return std::chrono::duration_cast<Clock::duration>(duration * options.time_scale);
+}
+
+SimulatedPrinterStatistics SimulatedPrinter::get_statistics() {
+    std::lock_guard lock(mutex);
+    return statistics;
+}
+
+std::vector<uint8_t> SimulatedPrinter::get_last_page_raster() {
+    std::lock_guard lock(mutex);
+    return last_page_raster;
+}
@@ -0,0 +1,131 @@
+#ifndef LABEL_PRINTER_DRIVER_SIMULATEDPRINTER_H
+#define LABEL_PRINTER_DRIVER_SIMULATEDPRINTER_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Transport.h"
+#include "PrinterStatus.h"
+
+/**
+ * Loaded media and timing of `SimulatedPrinter`.
+ */
+struct SimulatedPrinterOptions {
+    MediaType media_type = MediaType::CONTINUOUS_LENGTH_TAPE;
+    uint8_t media_width_mm = 62;
+    uint8_t media_length_mm = 0;  /**< 0 for continuous length tape */
+
+    double print_speed_mm_per_s = 150;
+    std::chrono::milliseconds page_overhead {150};  /**< Feeding and cutting of each page */
+
+    size_t cooling_after_pages = 0;  /**< Print head cools down after each such number of pages, 0 for never */
+    std::chrono::milliseconds cooling_time {3000};
+
+    size_t error_at_page = 0;  /**< Page (counted from 1) which fails with `error` instead of being printed, 0 for never */
+    ErrorType error = ErrorType::END_OF_MEDIA;
+    bool persistent_error = false;  /**< Whether initialization doesn't clear the error, so every following job fails */
+
+    size_t receive_buffer_pages = 2;  /**< Pages received ahead of printing, `send()` blocks while they are all taken */
+    double time_scale = 1;  /**< Multiplier of all of the times, 0 to print instantly */
+};
+
+/**
+ * What `SimulatedPrinter` has received and printed.
+ */
+struct SimulatedPrinterStatistics {
+    size_t received_bytes = 0;
+    size_t ignored_bytes = 0;  /**< Bytes which aren't a known command */
+    size_t raster_lines = 0;
+    size_t pages = 0;  /**< Printed pages */
+    size_t errors = 0;
+    size_t rejected_pages = 0;  /**< Pages received after an error, which fail as well */
+    size_t cooling_periods = 0;
+    size_t status_requests = 0;
+};
+
+/**
+ * Printer without hardware - transport which parses the raster command stream the way
+ * a QL printer does and answers with 32 bytes status messages after the time that printing
+ * would take. It allows the whole print loop to be benchmarked and tested without a printer.
+ *
+ * Recognized commands are invalidate (`0x00`), initialize (`0x1b 0x40`), status request
+ * (`0x1b 0x69 0x53`), print information (`0x1b 0x69 0x7a`), other `0x1b 0x69` settings,
+ * compression mode (`0x4d`), raster lines (`0x67 0x00 n`, compressed or not, and `0x5a`)
+ * and print commands (`0x0c` and `0x1a`). Commands can be split between transfers.
+ *
+ * Each printed page is reported with printing completed status followed by phase change to
+ * waiting to receive, once the page would be printed - pages are printed one after another
+ * at `print_speed_mm_per_s`. After every `cooling_after_pages` pages the printer reports
+ * start of cooling and doesn't print until it reports its end. The page `error_at_page` fails
+ * with error occurred status (followed by phase change) and so does every following page
+ * until the printer is initialized again (or for good with `persistent_error`). When `send()` times out waiting for room in the
+ * receive buffer, the page and the rest of the transfer are dropped.
+ */
+class SimulatedPrinter : public Transport {
+private:
+    using Clock = std::chrono::steady_clock;
+    using Packet = std::array<uint8_t, 32>;
+
+    struct Reply {
+        Clock::time_point time;
+        Packet packet;
+    };
+
+    const SimulatedPrinterOptions options;
+
+    std::vector<uint8_t> pending {};  /**< Received bytes which don't make a whole command yet */
+    bool compression = false;
+    bool failed = false;
+    size_t received_pages = 0;
+    std::vector<uint8_t> page_raster {};
+    std::vector<uint8_t> last_page_raster {};
+
+    /** Replies not read yet - a few per page in the receive buffer, room for them is reserved up front */
+    static constexpr size_t REPLY_CAPACITY = 64;
+
+    /* Both are short, vectors keep their memory so that a printer which is running doesn't allocate */
+    std::vector<Reply> replies {};
+    std::vector<Clock::time_point> page_finishes {};  /**< Pages in the receive buffer */
+    Clock::time_point busy_until {};
+    std::optional<Clock::time_point> send_deadline {};  /**< Of the transfer being received */
+    SimulatedPrinterStatistics statistics {};
+
+    std::mutex mutex;
+    std::condition_variable reply_ready;
+
+    /**
+     * Handles the command at the beginning of `data` (called with `lock` held).
+     *
+     * @return Size of the command, 0 if it isn't complete
+     */
+    size_t handle_command(const uint8_t *data, size_t size, std::unique_lock<std::mutex>& lock);
+
+    void add_raster_line(const uint8_t *data, size_t size);
+    void print_page(std::unique_lock<std::mutex>& lock);
+    void reply(Clock::time_point time, StatusType status, PhaseType phase,
+            ErrorType error = ErrorType::NO_ERROR, NotificationType notification = NotificationType::NOT_AVAILABLE);
+
+    [[nodiscard]] Clock::duration scaled(std::chrono::duration<double> duration) const noexcept;
+
+public:
+    static constexpr size_t RASTER_LINE_SIZE = 90;
+
+    explicit SimulatedPrinter(SimulatedPrinterOptions options = {});
+
+    size_t send(const uint8_t *data, size_t length, unsigned timeout_ms) override;
+    size_t receive(uint8_t *buffer, size_t length, unsigned timeout_ms) override;
+
+    [[nodiscard]] SimulatedPrinterStatistics get_statistics();
+
+    /**
+     * @return Uncompressed raster lines of the last printed page, `RASTER_LINE_SIZE` bytes each
+     */
+    [[nodiscard]] std::vector<uint8_t> get_last_page_raster();
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_SIMULATEDPRINTER_H
@@ -0,0 +1,66 @@
+#include <array>
+
+#include "StatusMonitor.h"
+#include "../exceptions/USBError.h"
+#include "../utils/Tracer.h"
+
+StatusMonitor::StatusMonitor(Transport& _transport)
+    : transport(_transport),
+    events(MAX_EVENTS),
+    running(true) {
+    monitor_thread = std::thread(&StatusMonitor::monitor, this);
+}
+
+StatusMonitor::~StatusMonitor() noexcept {
+    running = false;
+    events.close();
+    monitor_thread.join();
+}
+
+void StatusMonitor::monitor() noexcept {
+    std::array<uint8_t, 32> buffer {};
+
+    while(running) {
+        const auto start = Tracer::Clock::now();
+        size_t actual;
+        try {
+            actual = transport.receive(buffer.data(), buffer.size(), POLL_TIMEOUT_MS);
+        }
+        catch(const USBError& e) {
+            std::lock_guard lock(mutex);
+            error = e.error;
+            break;
+        }
+
+        // Status messages have fixed size, anything else (or nothing, after timeout) is not a status
+        if(actual != buffer.size())
+            continue;
+
+        const PrinterStatus status(buffer);
+        Tracer::record("status", "usb", start, Tracer::Clock::now(), "status", status.status_code);
+        if(!events.push(status))
+            break;
+    }
+
+    events.close();
+}
+
+PrinterStatus StatusMonitor::next() {
+    std::optional<PrinterStatus> status = events.pop();
+    if(status)
+        return *status;
+
+    std::lock_guard lock(mutex);
+    throw USBError(error.value_or("status monitor stopped"), "receiving status");
+}
+
+std::optional<PrinterStatus> StatusMonitor::try_next() {
+    std::optional<PrinterStatus> status = events.try_pop();
+    if(status)
+        return status;
+
+    std::lock_guard lock(mutex);
+    if(error)
+        throw USBError(*error, "receiving status");
+    return std::nullopt;
+}
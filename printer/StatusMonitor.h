@@ -0,0 +1,72 @@
+#ifndef LABEL_PRINTER_DRIVER_STATUSMONITOR_H
+#define LABEL_PRINTER_DRIVER_STATUSMONITOR_H
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "PrinterStatus.h"
+#include "Transport.h"
+#include "../utils/BoundedQueue.h"
+
+/**
+ * Reads status messages of the printer on a background thread and queues them as events.
+ *
+ * While printing, the printer reports progress of every page on its own (phase change,
+ * printing completed, errors), so the sender doesn't have to stop and wait for them - it
+ * can send following pages and only look at the events when it needs to. Reads time out
+ * after `POLL_TIMEOUT_MS`, so the monitor can be stopped at any time.
+ */
+class StatusMonitor {
+private:
+    Transport& transport;
+
+    BoundedQueue<PrinterStatus> events;
+    std::optional<std::string> error;
+    std::mutex mutex;
+
+    std::atomic<bool> running;
+    std::thread monitor_thread;
+
+    void monitor() noexcept;
+
+public:
+    static constexpr size_t MAX_EVENTS = 64;
+    static constexpr unsigned POLL_TIMEOUT_MS = 100;
+
+    /**
+     * Starts reading statuses.
+     *
+     * @param transport Connection to the printer, which must outlive the monitor
+     */
+    explicit StatusMonitor(Transport& transport);
+
+    /**
+     * Stops reading statuses (unread events are dropped) and joins the thread.
+     */
+    ~StatusMonitor() noexcept;
+
+    StatusMonitor(const StatusMonitor&) = delete;
+    StatusMonitor& operator=(const StatusMonitor&) = delete;
+
+    /**
+     * Takes the oldest status event. Blocks until there is one.
+     *
+     * @throws USBError if reading of statuses failed (the monitor is stopped then)
+     */
+    [[nodiscard]] PrinterStatus next();
+
+    /**
+     * Takes the oldest status event if there is one. Doesn't block.
+     *
+     * @return The event or `std::nullopt` if no event has come yet
+     *
+     * @throws USBError if reading of statuses failed and all of the events before the failure were taken
+     */
+    [[nodiscard]] std::optional<PrinterStatus> try_next();
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_STATUSMONITOR_H
@@ -0,0 +1,45 @@
+#ifndef LABEL_PRINTER_DRIVER_TRANSPORT_H
+#define LABEL_PRINTER_DRIVER_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Connection to the printer over which `Printer` sends commands and page data and
+ * from which it reads status messages.
+ *
+ * Sending and receiving can be done from different threads at the same time
+ * (see `StatusMonitor`), but each of them only from one thread at a time.
+ *
+ * @see UsbTransport
+ * @see SimulatedPrinter
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /**
+     * Sends `length` bytes of `data`. Blocks until the printer takes them.
+     *
+     * @param timeout_ms Maximal time of waiting for the printer to take the data, 0 for no limit
+     * @return Number of sent bytes
+     *
+     * @throws USBError if sending fails or the printer doesn't take the data in time
+     */
+    virtual size_t send(const uint8_t *data, size_t length, unsigned timeout_ms) = 0;
+
+    /**
+     * Reads one message from the printer into `buffer`.
+     *
+     * @param buffer Output buffer
+     * @param length Size of `buffer`
+     * @param timeout_ms Maximal time of waiting for a message, 0 for no limit
+     * @return Number of read bytes, 0 if no message came in time
+     *
+     * @throws USBError if reading fails
+     */
+    virtual size_t receive(uint8_t *buffer, size_t length, unsigned timeout_ms) = 0;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_TRANSPORT_H
@@ -0,0 +1,35 @@
+#include "UsbTransport.h"
+#include "../exceptions/USBError.h"
+#include "../utils/Logger.h"
+
+UsbTransport::UsbTransport(libusb_device_handle *_handle, const uint8_t _send_endpoint,
+        const uint8_t _receive_endpoint) noexcept
+    : handle(_handle),
+    send_endpoint(_send_endpoint),
+    receive_endpoint(_receive_endpoint) {}
+
+size_t UsbTransport::send(const uint8_t *data, const size_t length, const unsigned timeout_ms) {
+    int actual = 0;
+    const int ret = libusb_bulk_transfer(handle, send_endpoint, const_cast<uint8_t*>(data), static_cast<int>(length),
+            &actual, timeout_ms);
+
+    if(ret < LIBUSB_SUCCESS) {
+        Logger::error("libusb error: ", libusb_error_name(ret));
+        throw USBError(libusb_error_name(ret), "sending data");
+    }
+    return actual;
+}
+
+size_t UsbTransport::receive(uint8_t *buffer, const size_t length, const unsigned timeout_ms) {
+    int actual = 0;
+    const int ret = libusb_bulk_transfer(handle, receive_endpoint, buffer, static_cast<int>(length), &actual, timeout_ms);
+
+    // Part of a message can come before the timeout
+    if(ret == LIBUSB_ERROR_TIMEOUT)
+        return actual;
+    if(ret < LIBUSB_SUCCESS) {
+        Logger::error("libusb error: ", libusb_error_name(ret));
+        throw USBError(libusb_error_name(ret), "receiving data");
+    }
+    return actual;
+}
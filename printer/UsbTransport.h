@@ -0,0 +1,30 @@
+#ifndef LABEL_PRINTER_DRIVER_USBTRANSPORT_H
+#define LABEL_PRINTER_DRIVER_USBTRANSPORT_H
+
+#include <libusb-1.0/libusb.h>
+
+#include "Transport.h"
+
+/**
+ * Transport over bulk endpoints of a printer opened with libusb.
+ */
+class UsbTransport : public Transport {
+private:
+    libusb_device_handle *handle;
+    const uint8_t send_endpoint;
+    const uint8_t receive_endpoint;
+
+public:
+    /**
+     * @param handle Opened device with claimed interface, which must outlive the transport
+     * @param send_endpoint Bulk endpoint to which data is sent
+     * @param receive_endpoint Bulk endpoint from which status messages are read
+     */
+    UsbTransport(libusb_device_handle *handle, uint8_t send_endpoint, uint8_t receive_endpoint) noexcept;
+
+    size_t send(const uint8_t *data, size_t length, unsigned timeout_ms) override;
+    size_t receive(uint8_t *buffer, size_t length, unsigned timeout_ms) override;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_USBTRANSPORT_H
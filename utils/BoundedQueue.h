@@ -0,0 +1,110 @@
+#ifndef LABEL_PRINTER_DRIVER_BOUNDEDQUEUE_H
+#define LABEL_PRINTER_DRIVER_BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * Blocking FIFO queue with limited capacity, which is used to connect
+ * producer and consumer threads.
+ *
+ * `push()` blocks while the queue is full (which gives backpressure) and `pop()`
+ * blocks while it is empty. After `close()` no more items can be pushed and
+ * `pop()` returns `std::nullopt` once the remaining items are taken.
+ *
+ * Items are stored in a ring buffer allocated up front, so pushing and popping doesn't allocate.
+ *
+ * @tparam T Type of items
+ */
+template<typename T>
+class BoundedQueue {
+private:
+    std::vector<std::optional<T>> items;
+    size_t head = 0;  /**< Index of the front item */
+    size_t count = 0;
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+public:
+    /**
+     * @param capacity Maximal number of items in the queue (at least 1)
+     */
+    explicit BoundedQueue(size_t capacity) : items(capacity > 0 ? capacity : 1) {}
+
+    /**
+     * Pushes `item` to the end of the queue. Blocks while the queue is full.
+     *
+     * @return `false` if the queue has been closed (the item is dropped)
+     */
+    bool push(T item) {
+        std::unique_lock lock(mutex);
+        not_full.wait(lock, [this] { return count < items.size() || closed; });
+        if(closed)
+            return false;
+
+        items[(head + count) % items.size()].emplace(std::move(item));
+        ++count;
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * Takes item from the front of the queue. Blocks while the queue is empty.
+     *
+     * @return The item or `std::nullopt` if the queue is closed and empty
+     */
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        not_empty.wait(lock, [this] { return count > 0 || closed; });
+        if(count == 0)
+            return std::nullopt;
+
+        std::optional<T> item(std::move(items[head]));
+        items[head].reset();
+        head = (head + 1) % items.size();
+        --count;
+        lock.unlock();
+        not_full.notify_one();
+        return item;
+    }
+
+    /**
+     * Takes item from the front of the queue if there is one. Doesn't block.
+     *
+     * @return The item or `std::nullopt` if the queue is empty
+     */
+    std::optional<T> try_pop() {
+        std::unique_lock lock(mutex);
+        if(count == 0)
+            return std::nullopt;
+
+        std::optional<T> item(std::move(items[head]));
+        items[head].reset();
+        head = (head + 1) % items.size();
+        --count;
+        lock.unlock();
+        not_full.notify_one();
+        return item;
+    }
+
+    /**
+     * Closes the queue and wakes up all of the waiting threads.
+     */
+    void close() noexcept {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_BOUNDEDQUEUE_H
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "BufferPool.h"
+
+BufferPool::BufferPool(const size_t _max_buffers) : max_buffers(_max_buffers) {
+    free_buffers.reserve(max_buffers);
+}
+
+std::vector<uint8_t> BufferPool::acquire(const size_t size) {
+    std::vector<uint8_t> buffer {};
+    {
+        std::lock_guard lock(mutex);
+        ++statistics.acquired;
+
+        if(!free_buffers.empty()) {
+            // Best fit, otherwise the largest one
+            size_t chosen = 0;
+            for(size_t i = 1; i < free_buffers.size(); ++i) {
+                const size_t capacity = free_buffers[i].capacity();
+                const size_t chosen_capacity = free_buffers[chosen].capacity();
+                if(chosen_capacity < size ? capacity > chosen_capacity : capacity >= size && capacity < chosen_capacity)
+                    chosen = i;
+            }
+
+            buffer = std::move(free_buffers[chosen]);
+            if(chosen != free_buffers.size() - 1)
+                free_buffers[chosen] = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+
+        if(buffer.capacity() < size)
+            ++statistics.allocations;
+    }
+
+    if(buffer.capacity() < size)
+        buffer.reserve(size + size / HEADROOM_DIVISOR);
+    buffer.resize(size);
+    return buffer;
+}
+
+void BufferPool::reserve(const size_t count, const size_t size) {
+    std::lock_guard lock(mutex);
+
+    const size_t target = std::min(count, max_buffers);
+    size_t big_enough = std::count_if(free_buffers.begin(), free_buffers.end(),
+            [size](const std::vector<uint8_t>& buffer) { return buffer.capacity() >= size; });
+
+    for(auto& buffer: free_buffers) {
+        if(big_enough == target)
+            return;
+        if(buffer.capacity() < size) {
+            buffer.reserve(size + size / HEADROOM_DIVISOR);
+            ++statistics.allocations;
+            ++big_enough;
+        }
+    }
+
+    for(; big_enough < target; ++big_enough) {
+        free_buffers.emplace_back().reserve(size + size / HEADROOM_DIVISOR);
+        ++statistics.allocations;
+    }
+}
+
+void BufferPool::release(std::vector<uint8_t> buffer) noexcept {
+    if(buffer.capacity() == 0)
+        return;
+
+    std::unique_lock lock(mutex);
+    if(free_buffers.size() < max_buffers) {
+        free_buffers.push_back(std::move(buffer));
+        return;
+    }
+
+    ++statistics.dropped;
+    lock.unlock();  // Buffer is freed outside of the lock
+}
+
+BufferPoolStatistics BufferPool::get_statistics() const {
+    std::lock_guard lock(mutex);
+    return statistics;
+}
@@ -0,0 +1,77 @@
+#ifndef LABEL_PRINTER_DRIVER_BUFFERPOOL_H
+#define LABEL_PRINTER_DRIVER_BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Counters of a `BufferPool`.
+ */
+struct BufferPoolStatistics {
+    size_t acquired = 0;
+    size_t allocations = 0;  /**< Number of acquired buffers which had to be allocated or grown */
+    size_t dropped = 0;  /**< Number of released buffers which didn't fit in the pool */
+};
+
+/**
+ * Thread-safe pool of reusable byte buffers.
+ *
+ * Page buffers (label surfaces, printing data, messages for the printer) have the same
+ * few sizes over and over, so once the pool is warmed up buffers are only passed around
+ * and no memory is allocated.
+ */
+class BufferPool {
+private:
+    std::vector<std::vector<uint8_t>> free_buffers;  /**< Capacity is reserved up front, so releasing doesn't allocate */
+    const size_t max_buffers;
+    BufferPoolStatistics statistics {};
+
+    mutable std::mutex mutex;
+
+public:
+    static constexpr size_t DEFAULT_MAX_BUFFERS = 16;
+
+    /**
+     * Allocated buffers have 1/32 of the size on top, which covers job data, print command and growth
+     * of compressed data of a page. So a buffer taken for printing data can hold the message of any
+     * page of the same size later and buffers don't need to grow depending on which of them are free.
+     */
+    static constexpr size_t HEADROOM_DIVISOR = 32;
+
+    /**
+     * @param max_buffers Maximal number of kept free buffers, buffers released
+     * to a full pool are freed
+     */
+    explicit BufferPool(size_t max_buffers = DEFAULT_MAX_BUFFERS);
+
+    /**
+     * Takes the smallest free buffer that can hold `size` bytes. If there is none, the largest
+     * free buffer is grown (or a new one is allocated).
+     *
+     * @param size Requested size
+     * @return Buffer of `size` bytes with unspecified contents
+     */
+    [[nodiscard]] std::vector<uint8_t> acquire(size_t size);
+
+    /**
+     * Makes sure that at least `count` free buffers (but no more than the pool keeps) can hold `size`
+     * bytes, so that taking that many of them doesn't allocate - no matter how many of them happened
+     * to be taken at once before.
+     *
+     * @param count Number of buffers
+     * @param size Size of the buffers
+     */
+    void reserve(size_t count, size_t size);
+
+    /**
+     * Returns the buffer to the pool.
+     */
+    void release(std::vector<uint8_t> buffer) noexcept;
+
+    [[nodiscard]] BufferPoolStatistics get_statistics() const;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_BUFFERPOOL_H
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "Logger.h"
+
+std::atomic<LogLevel> Logger::level {LogLevel::INFO};
+
+Logger::MessageWriter::MessageWriter(char *begin, char *_end) noexcept
+    : position(begin),
+    end(_end) {}
+
+void Logger::MessageWriter::append(const std::string_view text) noexcept {
+    const size_t size = std::min<size_t>(text.size(), end - position);
+    std::memcpy(position, text.data(), size);
+    position += size;
+}
+
+void Logger::MessageWriter::append(const char c) noexcept {
+    if(position < end)
+        *position++ = c;
+}
+
+void Logger::MessageWriter::append(const bool value) noexcept {
+    append(std::string_view(value ? "true" : "false"));
+}
+
+void Logger::MessageWriter::append(const double value) noexcept {
+    char buffer[32];
+    const int size = std::snprintf(buffer, sizeof(buffer), "%g", value);
+    if(size > 0)
+        append(std::string_view(buffer, std::min<size_t>(size, sizeof(buffer) - 1)));
+}
+
+void Logger::MessageWriter::append_integer(const long long value) noexcept {
+    if(value < 0) {
+        append('-');
+        append_unsigned(0ull - static_cast<unsigned long long>(value));
+    }
+    else
+        append_unsigned(value);
+}
+
+void Logger::MessageWriter::append_unsigned(unsigned long long value) noexcept {
+    char buffer[20];
+    char *digits = buffer + sizeof(buffer);
+    do {
+        *--digits = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while(value > 0);
+
+    append(std::string_view(digits, buffer + sizeof(buffer) - digits));
+}
+
+const char *Logger::MessageWriter::get_position() const noexcept {
+    return position;
+}
+
+Logger::Logger()
+    : slots(std::make_unique<Slot[]>(CAPACITY)),
+    capacity(CAPACITY),
+    output(&std::cout) {
+    for(size_t i = 0; i < capacity; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    sink_thread = std::thread(&Logger::sink, this);
+}
+
+Logger::~Logger() noexcept {
+    {
+        std::lock_guard lock(mutex);
+        running = false;
+    }
+    wake_up.notify_one();
+    sink_thread.join();
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Slot *Logger::claim(const LogLevel message_level) noexcept {
+    // Slot at `position` is free when its sequence is `position`, and holds a message when it is `position + 1`
+    size_t position = enqueue_position.load(std::memory_order_relaxed);
+    while(true) {
+        Slot& slot = slots[position % capacity];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if(sequence == position) {
+            if(enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.level = message_level;
+                return &slot;
+            }
+        }
+        else if(sequence < position) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+            position = enqueue_position.load(std::memory_order_relaxed);
+    }
+}
+
+void Logger::commit(Slot& slot, const size_t length) noexcept {
+    const size_t position = slot.sequence.load(std::memory_order_relaxed);
+    const bool urgent = slot.level >= LogLevel::WARNING;
+
+    slot.length = static_cast<uint16_t>(length);
+    slot.sequence.store(position + 1, std::memory_order_release);
+
+    // Other messages wait for the next periodic flush, unless they come in a burst which would fill the ring buffer
+    if(urgent || position % (capacity / 4) == 0)
+        wake_up.notify_one();
+}
+
+void Logger::sink() noexcept {
+    std::unique_lock lock(mutex);
+    while(true) {
+        write_queued();
+        drained.notify_all();
+
+        if(!running)
+            break;
+        wake_up.wait_for(lock, FLUSH_INTERVAL);
+    }
+}
+
+bool Logger::write_queued() noexcept {
+    bool any = false;
+    while(true) {
+        Slot& slot = slots[dequeue_position % capacity];
+        if(slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+            break;
+
+        *output << level_name(slot.level) << std::string_view(slot.text, slot.length) << '\n';
+
+        slot.sequence.store(dequeue_position + capacity, std::memory_order_release);
+        ++dequeue_position;
+        any = true;
+    }
+
+    if(any)
+        output->flush();
+    return any;
+}
+
+const char *Logger::level_name(const LogLevel message_level) noexcept {
+    switch(message_level) {
+        case LogLevel::DEBUG:
+            return "[debug] ";
+        case LogLevel::INFO:
+            return "[info] ";
+        case LogLevel::WARNING:
+            return "[warning] ";
+        default:
+            return "[error] ";
+    }
+}
+
+void Logger::set_level(const LogLevel _level) noexcept {
+    level.store(_level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::get_level() noexcept {
+    return level.load(std::memory_order_relaxed);
+}
+
+void Logger::set_output(std::ostream& _output) {
+    Logger& logger = instance();
+
+    // Messages logged so far still go to the previous output
+    std::lock_guard lock(logger.mutex);
+    logger.write_queued();
+    logger.output = &_output;
+}
+
+void Logger::flush() {
+    Logger& logger = instance();
+    const size_t target = logger.enqueue_position.load(std::memory_order_acquire);
+
+    std::unique_lock lock(logger.mutex);
+    logger.wake_up.notify_one();
+    logger.drained.wait(lock, [&] { return logger.dequeue_position >= target; });
+}
+
+size_t Logger::get_dropped() noexcept {
+    return instance().dropped.load(std::memory_order_relaxed);
+}
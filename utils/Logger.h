@@ -0,0 +1,185 @@
+#ifndef LABEL_PRINTER_DRIVER_LOGGER_H
+#define LABEL_PRINTER_DRIVER_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class LogLevel : uint8_t {
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR,
+    OFF
+};
+
+/**
+ * Asynchronous leveled logger of the driver.
+ *
+ * Messages are formatted straight into slots of a lock-free ring buffer (without allocation)
+ * and written to the output by a background thread, which flushes the output once per batch
+ * of messages - logging threads never wait for the output. Messages below the current level
+ * (`LogLevel::INFO` by default) cost only a relaxed atomic load, so per-page messages are
+ * logged at `LogLevel::DEBUG`. When the ring buffer is full, messages are dropped (and counted)
+ * rather than blocking.
+ *
+ * Messages are built from any number of strings, characters and numbers:
+ *
+ *     Logger::debug("Sent ", actual, " bytes");
+ */
+class Logger {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        uint16_t length;
+        char text[512];
+    };
+
+    /**
+     * Appends parts of a message into a slot, the rest of a message that doesn't fit is cut off.
+     */
+    class MessageWriter {
+    private:
+        char *position;
+        char *const end;
+
+    public:
+        MessageWriter(char *begin, char *end) noexcept;
+
+        void append(std::string_view text) noexcept;
+        void append(char c) noexcept;
+        void append(bool value) noexcept;
+        void append(double value) noexcept;
+        void append_integer(long long value) noexcept;
+        void append_unsigned(unsigned long long value) noexcept;
+
+        template<typename T>
+        void append(const T& value) noexcept {
+            if constexpr(std::is_integral_v<T> && std::is_signed_v<T>)
+                append_integer(value);
+            else if constexpr(std::is_integral_v<T>)
+                append_unsigned(value);
+            else if constexpr(std::is_floating_point_v<T>)
+                append(static_cast<double>(value));
+            else if constexpr(std::is_enum_v<T>)
+                append_unsigned(static_cast<unsigned long long>(value));
+            else
+                append(std::string_view(value));
+        }
+
+        [[nodiscard]] const char *get_position() const noexcept;
+    };
+
+    static std::atomic<LogLevel> level;
+
+    const std::unique_ptr<Slot[]> slots;
+    const size_t capacity;
+    std::atomic<size_t> enqueue_position {0};
+    size_t dequeue_position = 0;  /**< Only the sink thread takes messages */
+    std::atomic<size_t> dropped {0};
+
+    std::ostream *output;
+    std::mutex mutex;
+    std::condition_variable wake_up;
+    std::condition_variable drained;
+    bool running = true;
+    std::thread sink_thread;
+
+    Logger();
+    ~Logger() noexcept;
+
+    static Logger& instance();
+
+    /**
+     * @return Slot for a message of given level or `nullptr` if the ring buffer is full
+     */
+    Slot *claim(LogLevel level) noexcept;
+    void commit(Slot& slot, size_t length) noexcept;
+
+    void sink() noexcept;
+
+    /**
+     * Writes all of the queued messages (called by the sink thread with `mutex` locked).
+     *
+     * @return Whether there were any
+     */
+    bool write_queued() noexcept;
+
+    static const char *level_name(LogLevel level) noexcept;
+
+public:
+    static constexpr size_t CAPACITY = 512;  /**< Number of slots of the ring buffer */
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL {50};
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * Sets the lowest level of messages which are logged.
+     */
+    static void set_level(LogLevel level) noexcept;
+    [[nodiscard]] static LogLevel get_level() noexcept;
+
+    /**
+     * @return Whether messages of `level` are logged, so that expensive messages can be skipped early
+     */
+    [[nodiscard]] static bool enabled(LogLevel level) noexcept {
+        return level >= Logger::level.load(std::memory_order_relaxed) && level != LogLevel::OFF;
+    }
+
+    /**
+     * Sets stream to which messages are written (`std::cout` by default). The stream
+     * must outlive the logger or another stream must be set before it is destroyed.
+     */
+    static void set_output(std::ostream& output);
+
+    /**
+     * Blocks until all of the messages logged so far are written and the output is flushed.
+     */
+    static void flush();
+
+    /**
+     * @return Number of messages which were dropped because the ring buffer was full
+     */
+    [[nodiscard]] static size_t get_dropped() noexcept;
+
+    template<typename... Args>
+    static void log(const LogLevel level, const Args&... args) noexcept {
+        if(!enabled(level))
+            return;
+
+        Logger& logger = instance();
+        Slot *slot = logger.claim(level);
+        if(slot == nullptr)
+            return;
+
+        MessageWriter writer(slot->text, slot->text + sizeof(slot->text));
+        (writer.append(args), ...);
+        logger.commit(*slot, writer.get_position() - slot->text);
+    }
+
+    template<typename... Args>
+    static void debug(const Args&... args) noexcept { log(LogLevel::DEBUG, args...); }
+
+    template<typename... Args>
+    static void info(const Args&... args) noexcept { log(LogLevel::INFO, args...); }
+
+    template<typename... Args>
+    static void warning(const Args&... args) noexcept { log(LogLevel::WARNING, args...); }
+
+    template<typename... Args>
+    static void error(const Args&... args) noexcept { log(LogLevel::ERROR, args...); }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_LOGGER_H
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#include "Metrics.h"
+
+std::array<LatencyHistogram, Metrics::STAGES> Metrics::histograms {};
+std::array<std::atomic<uint64_t>, Metrics::COUNTERS> Metrics::counters {};
+
+namespace {
+    struct CounterInfo {
+        const char *name;
+        const char *help;
+    };
+
+    constexpr std::array<CounterInfo, 6> __counters {{
+            {"label_printer_jobs_total", "Print jobs started"},
+            {"label_printer_labels_printed_total", "Labels reported as printed by the printer"},
+            {"label_printer_sent_bytes_total", "Bytes transferred to the printer"},
+            {"label_printer_printer_errors_total", "Errors reported by the printer"},
+            {"label_printer_transfer_errors_total", "Failed transfers to the printer"},
+            {"label_printer_cooling_events_total", "Cooling periods of the print head"}
+    }};
+
+    void write_value(std::ostream& output, const double value) {
+        if(std::isnan(value))
+            output << "NaN";
+        else
+            output << value;
+    }
+}
+
+size_t LatencyHistogram::bucket_index(const uint64_t ns) noexcept {
+    if(ns < 2 * SUB_BUCKETS)
+        return ns;
+
+    // Bucket of the highest set bit and `log2(SUB_BUCKETS)` bits below it
+    const unsigned exponent = 63 - __builtin_clzll(ns);
+    const uint64_t sub_bucket = (ns >> (exponent - 4)) & (SUB_BUCKETS - 1);
+    return (exponent - 3) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(const size_t index) noexcept {
+    if(index < 2 * SUB_BUCKETS)
+        return index;
+
+    const size_t exponent = index / SUB_BUCKETS + 3;
+    return (SUB_BUCKETS + index % SUB_BUCKETS) << (exponent - 4);
+}
+
+void LatencyHistogram::record(const std::chrono::nanoseconds duration) noexcept {
+    const uint64_t ns = duration.count() > 0 ? duration.count() : 0;
+
+    buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_count() const noexcept {
+    return count.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::get_sum_seconds() const noexcept {
+    return static_cast<double>(sum_ns.load(std::memory_order_relaxed)) * 1e-9;
+}
+
+double LatencyHistogram::quantile(const double q) const noexcept {
+    // Buckets are read one by one while other threads may record, so the total is taken from them
+    std::array<uint64_t, BUCKETS> snapshot {};
+    uint64_t total = 0;
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if(total == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))), 1);
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        seen += snapshot[i];
+        if(seen >= rank) {
+            const uint64_t lower = bucket_lower_bound(i);
+            const uint64_t upper = i + 1 < BUCKETS ? bucket_lower_bound(i + 1) : lower;
+            return static_cast<double>(lower + (upper - lower) / 2) * 1e-9;
+        }
+    }
+    return static_cast<double>(bucket_lower_bound(BUCKETS - 1)) * 1e-9;
+}
+
+void LatencyHistogram::reset() noexcept {
+    for(auto& bucket: buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum_ns.store(0, std::memory_order_relaxed);
+}
+
+const char *Metrics::stage_name(const PrintStage stage) noexcept {
+    switch(stage) {
+        case PrintStage::RENDER:
+            return "render";
+        case PrintStage::RASTERIZE:
+            return "rasterize";
+        case PrintStage::USB_SEND:
+            return "usb_send";
+        default:
+            return "print_wait";
+    }
+}
+
+void Metrics::record(const PrintStage stage, const Clock::duration duration) noexcept {
+    histograms[static_cast<size_t>(stage)].record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration));
+}
+
+void Metrics::increment(const PrintCounter counter, const uint64_t value) noexcept {
+    counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+const LatencyHistogram& Metrics::get_histogram(const PrintStage stage) noexcept {
+    return histograms[static_cast<size_t>(stage)];
+}
+
+uint64_t Metrics::get_counter(const PrintCounter counter) noexcept {
+    return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+void Metrics::reset() noexcept {
+    for(auto& histogram: histograms)
+        histogram.reset();
+    for(auto& counter: counters)
+        counter.store(0, std::memory_order_relaxed);
+}
+
+void Metrics::write_prometheus(std::ostream& output) {
+    constexpr const char *DURATION = "label_printer_stage_duration_seconds";
+
+    output << std::setprecision(9);
+    output << "# HELP " << DURATION << " Duration of stages of printing a label\n";
+    output << "# TYPE " << DURATION << " summary\n";
+    for(size_t i = 0; i < STAGES; ++i) {
+        const char *stage = stage_name(static_cast<PrintStage>(i));
+        const LatencyHistogram& histogram = histograms[i];
+
+        for(const double q: QUANTILES) {
+            output << DURATION << "{stage=\"" << stage << "\",quantile=\"" << q << "\"} ";
+            write_value(output, histogram.quantile(q));
+            output << '\n';
+        }
+        output << DURATION << "_sum{stage=\"" << stage << "\"} " << histogram.get_sum_seconds() << '\n';
+        output << DURATION << "_count{stage=\"" << stage << "\"} " << histogram.get_count() << '\n';
+    }
+
+    for(size_t i = 0; i < COUNTERS; ++i) {
+        output << "# HELP " << __counters[i].name << ' ' << __counters[i].help << '\n';
+        output << "# TYPE " << __counters[i].name << " counter\n";
+        output << __counters[i].name << ' ' << counters[i].load(std::memory_order_relaxed) << '\n';
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef LABEL_PRINTER_DRIVER_METRICS_H
+#define LABEL_PRINTER_DRIVER_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Stages of printing a label whose latency is measured.
+ */
+enum class PrintStage : uint8_t {
+    RENDER,  /**< `Label::render()`, for product labels `ProductLabelCreator::create_label_surface()` */
+    RASTERIZE,  /**< `Label::rasterize()`, for product labels `ProductLabel::prepare_for_printing()` */
+    USB_SEND,  /**< One bulk transfer, from its start (or submission) until it is completed */
+    PRINT_WAIT  /**< From sending (or submitting) page data until the printer reports the page printed */
+};
+
+enum class PrintCounter : uint8_t {
+    JOBS,
+    LABELS_PRINTED,
+    BYTES_SENT,
+    PRINTER_ERRORS,  /**< Error statuses reported by the printer */
+    TRANSFER_ERRORS,  /**< Failed or short transfers */
+    COOLING_EVENTS  /**< Cooling periods of the print head */
+};
+
+/**
+ * Lock-free histogram of durations with log-linear buckets: each power of two of nanoseconds is split
+ * into `SUB_BUCKETS` buckets, so quantiles are estimated within about 3% in any range - from
+ * microseconds of a transfer to seconds of printing. Recording is a few relaxed atomic increments.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t BUCKETS = (64 - 3) * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets {};
+    std::atomic<uint64_t> count {0};
+    std::atomic<uint64_t> sum_ns {0};
+
+    [[nodiscard]] static size_t bucket_index(uint64_t ns) noexcept;
+    [[nodiscard]] static uint64_t bucket_lower_bound(size_t index) noexcept;
+
+public:
+    void record(std::chrono::nanoseconds duration) noexcept;
+
+    [[nodiscard]] uint64_t get_count() const noexcept;
+    [[nodiscard]] double get_sum_seconds() const noexcept;
+
+    /**
+     * @param q Quantile in range <0, 1>, for example 0.99
+     * @return Estimated duration in seconds (middle of the bucket), NaN if nothing was recorded
+     */
+    [[nodiscard]] double quantile(double q) const noexcept;
+
+    void reset() noexcept;
+};
+
+/**
+ * Process-wide latency histograms of print stages and throughput counters, cheap enough to be always on.
+ * They are exported in Prometheus text format by `write_prometheus()` (see `MetricsExporter`).
+ */
+class Metrics {
+private:
+    static constexpr size_t STAGES = 4;
+    static constexpr size_t COUNTERS = 6;
+
+    static std::array<LatencyHistogram, STAGES> histograms;
+    static std::array<std::atomic<uint64_t>, COUNTERS> counters;
+
+    static const char *stage_name(PrintStage stage) noexcept;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::array<double, 3> QUANTILES {0.5, 0.95, 0.99};
+
+    static void record(PrintStage stage, Clock::duration duration) noexcept;
+    static void increment(PrintCounter counter, uint64_t value = 1) noexcept;
+
+    [[nodiscard]] static const LatencyHistogram& get_histogram(PrintStage stage) noexcept;
+    [[nodiscard]] static uint64_t get_counter(PrintCounter counter) noexcept;
+
+    /**
+     * Clears all of the histograms and counters (counters of a running process shouldn't go
+     * back for Prometheus, so this is meant for tests and benchmarks).
+     */
+    static void reset() noexcept;
+
+    /**
+     * Writes histograms (as summaries with `QUANTILES`) and counters in Prometheus text exposition format.
+     */
+    static void write_prometheus(std::ostream& output);
+};
+
+/**
+ * Records duration of a stage from its construction until its destruction.
+ */
+class StageTimer {
+private:
+    const PrintStage stage;
+    const Metrics::Clock::time_point start;
+
+public:
+    explicit StageTimer(const PrintStage _stage) noexcept
+        : stage(_stage),
+        start(Metrics::Clock::now()) {}
+
+    ~StageTimer() noexcept {
+        Metrics::record(stage, Metrics::Clock::now() - start);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_METRICS_H
@@ -0,0 +1,134 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "Logger.h"
+
+MetricsExporter::MetricsExporter(MetricsExporterOptions _options)
+    : options(std::move(_options)),
+    running(true) {
+    if(!options.socket_path.empty()) {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if(options.socket_path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Invalid metrics socket path: " + options.socket_path);
+        std::strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(server_fd < 0)
+            throw std::runtime_error(std::string("Creating metrics socket failed: ") + std::strerror(errno));
+
+        unlink(options.socket_path.c_str());
+        if(bind(server_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+                || listen(server_fd, SOMAXCONN) < 0) {
+            const std::runtime_error error("Listening on " + options.socket_path + " failed: " + std::strerror(errno));
+            close(server_fd);
+            throw error;
+        }
+
+        Logger::info("Serving metrics on ", options.socket_path);
+    }
+
+    exporter_thread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() noexcept {
+    {
+        std::lock_guard lock(mutex);
+        running = false;
+    }
+    stop_requested.notify_one();
+    exporter_thread.join();
+
+    if(server_fd >= 0) {
+        close(server_fd);
+        unlink(options.socket_path.c_str());
+    }
+}
+
+void MetricsExporter::run() noexcept {
+    auto next_export = std::chrono::steady_clock::now();
+
+    while(running) {
+        if(!options.file_path.empty() && std::chrono::steady_clock::now() >= next_export) {
+            write_file();
+            next_export += options.interval;
+        }
+
+        if(server_fd >= 0) {
+            pollfd server {server_fd, POLLIN, 0};
+            if(poll(&server, 1, POLL_TIMEOUT_MS) > 0) {
+                const int client_fd = accept(server_fd, nullptr, nullptr);
+                if(client_fd >= 0) {
+                    serve_client(client_fd);
+                    close(client_fd);
+                }
+            }
+        }
+        else {
+            std::unique_lock lock(mutex);
+            stop_requested.wait_until(lock, next_export, [this] { return !running; });
+        }
+    }
+
+    if(!options.file_path.empty())
+        write_file();
+}
+
+void MetricsExporter::write_file() noexcept {
+    try {
+        const std::string temporary = options.file_path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            Metrics::write_prometheus(file);
+            if(!file.flush())
+                throw std::runtime_error("writing " + temporary + " failed");
+        }
+
+        if(std::rename(temporary.c_str(), options.file_path.c_str()) != 0)
+            throw std::runtime_error(std::string("renaming failed: ") + std::strerror(errno));
+    }
+    catch(const std::exception& e) {
+        Logger::warning("Exporting metrics to ", options.file_path, " failed: ", e.what());
+    }
+}
+
+void MetricsExporter::serve_client(const int client_fd) noexcept {
+    try {
+        // Scrapers send an HTTP request first, plain clients (such as `socat`) send nothing
+        char request[512];
+        pollfd client {client_fd, POLLIN, 0};
+        const bool http = poll(&client, 1, REQUEST_TIMEOUT_MS) > 0
+                && recv(client_fd, request, sizeof(request), 0) >= 3 && std::strncmp(request, "GET", 3) == 0;
+
+        std::ostringstream body;
+        Metrics::write_prometheus(body);
+
+        std::string response = body.str();
+        if(http) {
+            response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                    + std::to_string(response.size()) + "\r\nConnection: close\r\n\r\n" + response;
+        }
+
+        for(size_t sent = 0; sent < response.size();) {
+            const ssize_t ret = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if(ret < 0 && errno == EINTR)
+                continue;
+            if(ret <= 0)
+                break;
+            sent += ret;
+        }
+    }
+    catch(const std::exception& e) {
+        Logger::warning("Serving metrics failed: ", e.what());
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef LABEL_PRINTER_DRIVER_METRICSEXPORTER_H
+#define LABEL_PRINTER_DRIVER_METRICSEXPORTER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct MetricsExporterOptions {
+    /**
+     * File rewritten with the metrics every `interval` (for example for the textfile collector
+     * of the node exporter), empty for none. It is replaced atomically, so it is never read half-written.
+     */
+    std::string file_path;
+    std::chrono::milliseconds interval {10000};
+
+    /**
+     * Unix domain socket which answers each connection with the metrics, empty for none. HTTP requests
+     * (`curl --unix-socket <path> http://localhost/metrics`) get an HTTP response, other clients plain text.
+     */
+    std::string socket_path;
+
+    [[nodiscard]] bool enabled() const noexcept {
+        return !file_path.empty() || !socket_path.empty();
+    }
+};
+
+/**
+ * Exports `Metrics` in Prometheus text format to a file and/or a local socket on a background thread,
+ * so that printing threads only ever touch the atomic counters.
+ *
+ * @see Metrics::write_prometheus()
+ */
+class MetricsExporter {
+private:
+    static constexpr int POLL_TIMEOUT_MS = 100;
+    static constexpr int REQUEST_TIMEOUT_MS = 100;
+
+    const MetricsExporterOptions options;
+    int server_fd = -1;
+
+    std::mutex mutex;
+    std::condition_variable stop_requested;
+    std::atomic<bool> running;
+    std::thread exporter_thread;
+
+    void run() noexcept;
+    void write_file() noexcept;
+    void serve_client(int client_fd) noexcept;
+
+public:
+    /**
+     * Starts listening on the socket (an existing file at its path is replaced) and starts the exporter thread.
+     *
+     * @throws std::runtime_error if the socket can't be set up
+     */
+    explicit MetricsExporter(MetricsExporterOptions options);
+
+    /**
+     * Stops the thread, writes the file for the last time and removes the socket.
+     */
+    ~MetricsExporter() noexcept;
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_METRICSEXPORTER_H
@@ -0,0 +1,67 @@
+#ifndef LABEL_PRINTER_DRIVER_OBJECTPOOL_H
+#define LABEL_PRINTER_DRIVER_OBJECTPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Thread-safe pool of reusable heap objects.
+ *
+ * Released objects are not destroyed, so they keep memory of their members (for example
+ * capacity of strings) and taking them again allocates nothing. The counterpart of
+ * `BufferPool` for the small per-label objects of the print loop.
+ */
+template<typename T>
+class ObjectPool {
+private:
+    std::vector<std::unique_ptr<T>> free_objects;  /**< Capacity is reserved up front, so releasing doesn't allocate */
+    mutable std::mutex mutex;
+
+public:
+    static constexpr size_t DEFAULT_MAX_OBJECTS = 32;
+
+    /**
+     * @param max_objects Maximal number of kept free objects, objects released
+     * to a full pool are destroyed
+     */
+    explicit ObjectPool(const size_t max_objects = DEFAULT_MAX_OBJECTS) {
+        free_objects.reserve(max_objects);
+    }
+
+    /**
+     * @return Previously released object in the state it was released in, or a new value-initialized one
+     */
+    [[nodiscard]] std::unique_ptr<T> acquire() {
+        {
+            std::lock_guard lock(mutex);
+            if(!free_objects.empty()) {
+                std::unique_ptr<T> object = std::move(free_objects.back());
+                free_objects.pop_back();
+                return object;
+            }
+        }
+
+        return std::make_unique<T>();
+    }
+
+    /**
+     * Returns the object to the pool.
+     */
+    void release(std::unique_ptr<T> object) noexcept {
+        if(!object)
+            return;
+
+        std::unique_lock lock(mutex);
+        if(free_objects.size() < free_objects.capacity()) {
+            free_objects.push_back(std::move(object));
+            return;
+        }
+
+        lock.unlock();  // Object is destroyed outside of the lock
+    }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_OBJECTPOOL_H
@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads) {
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threads);
+    for(size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+
+    for(auto& worker: workers)
+        worker.join();
+}
+
+void ThreadPool::work() noexcept {
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if(tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();  // Exceptions are stored in the task's future
+    }
+}
+
+size_t ThreadPool::size() const noexcept {
+    return workers.size();
+}
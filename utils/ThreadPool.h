@@ -0,0 +1,69 @@
+#ifndef LABEL_PRINTER_DRIVER_THREADPOOL_H
+#define LABEL_PRINTER_DRIVER_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads executing submitted tasks in FIFO order.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+
+    std::mutex mutex;
+    std::condition_variable task_available;
+
+    void work() noexcept;
+
+public:
+    /**
+     * Starts worker threads.
+     *
+     * @param threads Number of threads, `0` means one thread per hardware thread
+     */
+    explicit ThreadPool(size_t threads = 0);
+
+    /**
+     * Finishes all of the queued tasks and joins worker threads.
+     */
+    ~ThreadPool() noexcept;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Queues `task` for execution.
+     *
+     * @param task Callable without arguments
+     * @return Future with result of `task` (or the exception it threw)
+     */
+    template<typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard lock(mutex);
+            tasks.emplace_back([packaged] { (*packaged)(); });
+        }
+        task_available.notify_one();
+
+        return result;
+    }
+
+    [[nodiscard]] size_t size() const noexcept;
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_THREADPOOL_H
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "Tracer.h"
+#include "Logger.h"
+
+std::atomic<bool> Tracer::enabled {false};
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        const char *category;
+        Tracer::Clock::time_point start;
+        Tracer::Clock::time_point end;
+        uint64_t async_id;
+        const char *arg_name;
+        int64_t arg;
+    };
+
+    struct ThreadEvents {
+        uint32_t tid = 0;
+        std::mutex mutex;
+        std::vector<TraceEvent> events {};
+        size_t dropped = 0;
+    };
+
+    /* Buffers of all of the threads which recorded a span, kept after the threads end until they are written */
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadEvents>> registry {};
+    uint32_t next_tid = 1;
+    Tracer::Clock::time_point epoch {};
+    std::string output_file {};
+
+    ThreadEvents& thread_events() {
+        thread_local const std::shared_ptr<ThreadEvents> events = [] {
+            auto created = std::make_shared<ThreadEvents>();
+            std::lock_guard lock(registry_mutex);
+            created->tid = next_tid++;
+            registry.push_back(created);
+            return created;
+        }();
+        return *events;
+    }
+
+    void write_event(std::ostream& output, const char *phase, const TraceEvent& event, const uint32_t tid,
+            const Tracer::Clock::time_point time, const bool with_duration) {
+        const auto microseconds = [](const Tracer::Clock::duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        };
+
+        output << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"" << phase
+               << "\",\"pid\":" << getpid() << ",\"tid\":" << tid << ",\"ts\":" << microseconds(time - epoch);
+        if(with_duration)
+            output << ",\"dur\":" << microseconds(event.end - event.start);
+        if(event.async_id != 0)
+            output << ",\"id\":" << event.async_id;
+        if(event.arg_name != nullptr)
+            output << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << "}";
+        output << "}";
+    }
+}
+
+void Tracer::start(const std::string& _output_file) {
+    std::lock_guard lock(registry_mutex);
+
+    // Buffers of threads which have ended are dropped, the others are only cleared
+    registry.erase(std::remove_if(registry.begin(), registry.end(),
+            [](const std::shared_ptr<ThreadEvents>& events) { return events.use_count() == 1; }), registry.end());
+    for(const auto& events: registry) {
+        std::lock_guard events_lock(events->mutex);
+        events->events.clear();
+        events->dropped = 0;
+    }
+
+    output_file = _output_file;
+    epoch = Clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+bool Tracer::start_from_environment() {
+    const char *file = std::getenv(ENVIRONMENT_VARIABLE);
+    if(file == nullptr || *file == '\0')
+        return false;
+
+    start(file);
+    Logger::info("Tracing into ", file);
+    return true;
+}
+
+void Tracer::stop() {
+    enabled.store(false, std::memory_order_relaxed);
+
+    std::string file;
+    {
+        std::lock_guard lock(registry_mutex);
+        file = output_file;
+    }
+    if(file.empty())
+        return;
+
+    std::ofstream output(file, std::ios::trunc);
+    write_chrome_trace(output);
+    if(!output.flush())
+        throw std::runtime_error("Writing trace into " + file + " failed");
+    Logger::info("Trace written into ", file);
+}
+
+void Tracer::append(const char *name, const char *category, const Clock::time_point start, const Clock::time_point end,
+        const uint64_t async_id, const char *arg_name, const int64_t arg) noexcept {
+    try {
+        ThreadEvents& events = thread_events();
+        std::lock_guard lock(events.mutex);
+        if(events.events.size() >= MAX_EVENTS_PER_THREAD)
+            ++events.dropped;
+        else
+            events.events.push_back({name, category, start, end, async_id, arg_name, arg});
+    }
+    catch(...) {
+        // Running out of memory for the trace must not break printing
+    }
+}
+
+void Tracer::record(const char *name, const char *category, const Clock::time_point start, const Clock::time_point end,
+        const char *arg_name, const int64_t arg) noexcept {
+    if(is_enabled())
+        append(name, category, start, end, 0, arg_name, arg);
+}
+
+void Tracer::record_async(const char *name, const char *category, const uint64_t id, const Clock::time_point start,
+        const Clock::time_point end, const char *arg_name, const int64_t arg) noexcept {
+    // Id 0 marks spans which nest, so ids are shifted
+    if(is_enabled())
+        append(name, category, start, end, id + 1, arg_name, arg);
+}
+
+void Tracer::write_chrome_trace(std::ostream& output) {
+    std::lock_guard lock(registry_mutex);
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    bool first = true;
+    size_t dropped = 0;
+    for(const auto& events: registry) {
+        std::lock_guard events_lock(events->mutex);
+        dropped += events->dropped;
+
+        for(const TraceEvent& event: events->events) {
+            output << (first ? "\n" : ",\n");
+            first = false;
+
+            // Overlapping spans are written as begin and end of an async span
+            if(event.async_id == 0)
+                write_event(output, "X", event, events->tid, event.start, true);
+            else {
+                write_event(output, "b", event, events->tid, event.start, false);
+                output << ",\n";
+                write_event(output, "e", event, events->tid, event.end, false);
+            }
+        }
+    }
+    output << "\n]}\n";
+
+    if(dropped > 0)
+        Logger::warning("Trace is missing ", dropped, " spans, buffers of threads were full");
+}
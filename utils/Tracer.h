@@ -0,0 +1,122 @@
+#ifndef LABEL_PRINTER_DRIVER_TRACER_H
+#define LABEL_PRINTER_DRIVER_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Opt-in tracer which records spans of individual print jobs (config load, printer scan, text layout,
+ * rendering, raster conversion, transfers, status messages) and writes them as Chrome trace event JSON,
+ * which can be opened in Perfetto or `chrome://tracing` to see where one slow job stalled.
+ *
+ * Spans are recorded into buffers of their threads, so threads don't contend while tracing. While tracing
+ * is stopped (the default), a span costs only a relaxed atomic load. At most `MAX_EVENTS_PER_THREAD`
+ * spans are kept per thread, later ones are dropped.
+ *
+ * Names, categories and argument names of spans must be string literals (they are stored as pointers).
+ */
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_EVENTS_PER_THREAD = 1u << 20u;
+    static constexpr const char *ENVIRONMENT_VARIABLE = "LABEL_PRINTER_TRACE";
+
+private:
+    static std::atomic<bool> enabled;
+
+    /**
+     * Appends a span to the buffer of the calling thread, `async_id` is 0 for spans which nest.
+     */
+    static void append(const char *name, const char *category, Clock::time_point start, Clock::time_point end,
+            uint64_t async_id, const char *arg_name, int64_t arg) noexcept;
+
+public:
+    /**
+     * Clears recorded spans and starts tracing.
+     *
+     * @param output_file File to which `stop()` writes the trace, empty to write it only with `write_chrome_trace()`
+     */
+    static void start(const std::string& output_file = "");
+
+    /**
+     * Starts tracing into the file named by `LABEL_PRINTER_TRACE` environment variable, if it is set.
+     *
+     * @return Whether tracing was started
+     */
+    static bool start_from_environment();
+
+    /**
+     * Stops tracing and writes the trace into the file given to `start()`. Spans which
+     * are still open are dropped.
+     *
+     * @throws std::runtime_error if the file can't be written
+     */
+    static void stop();
+
+    [[nodiscard]] static bool is_enabled() noexcept {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Writes spans recorded so far in Chrome trace event format (JSON object format).
+     */
+    static void write_chrome_trace(std::ostream& output);
+
+    /**
+     * Records a span of the calling thread, which nests with its other spans.
+     */
+    static void record(const char *name, const char *category, Clock::time_point start, Clock::time_point end,
+            const char *arg_name = nullptr, int64_t arg = 0) noexcept;
+
+    /**
+     * Records a span which overlaps others, such as an asynchronous transfer from its submission
+     * until its completion. It is shown on its own track, identified by `id`.
+     */
+    static void record_async(const char *name, const char *category, uint64_t id, Clock::time_point start,
+            Clock::time_point end, const char *arg_name = nullptr, int64_t arg = 0) noexcept;
+};
+
+/**
+ * Records a span from its construction until its destruction, if tracing is enabled at construction.
+ */
+class TraceSpan {
+private:
+    const char *const name;
+    const char *const category;
+    const bool active;
+    Tracer::Clock::time_point start {};
+    const char *arg_name = nullptr;
+    int64_t arg = 0;
+
+public:
+    TraceSpan(const char *_name, const char *_category) noexcept
+        : name(_name),
+        category(_category),
+        active(Tracer::is_enabled()) {
+        if(active)
+            start = Tracer::Clock::now();
+    }
+
+    ~TraceSpan() noexcept {
+        if(active)
+            Tracer::record(name, category, start, Tracer::Clock::now(), arg_name, arg);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    /**
+     * Sets the argument shown with the span (for example size of a transfer).
+     */
+    void set_arg(const char *_arg_name, const int64_t _arg) noexcept {
+        arg_name = _arg_name;
+        arg = _arg;
+    }
+};
+
+
+#endif //LABEL_PRINTER_DRIVER_TRACER_H